@@ -295,7 +295,8 @@ void Main::refresh(bool _override)
 			QListWidgetItem* blockItem = new QListWidgetItem(QString("#%1 %2").arg(d.number).arg(h.abridged().c_str()), ui->blocks);
 			blockItem->setData(Qt::UserRole, QByteArray((char const*)h.data(), h.size));
 			int n = 0;
-			for (auto const& i: RLP(bc.block(h))[1])
+			auto blockData = bc.block(h);
+			for (auto const& i: RLP(blockData)[1])
 			{
 				Transaction t(i.data());
 				QString s = t.receiveAddress ?
@@ -0,0 +1,182 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file main.cpp
+ * @author agent <agent@local>
+ * @date 2014
+ * VM benchmarks: runs a corpus of canned contracts through VM::go() on a FakeExtVM and reports throughput.
+ */
+
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <iomanip>
+#include "../json_spirit/json_spirit_writer_template.h"
+#include <VM.h>
+#include <Instruction.h>
+#include "FakeExtVM.h"
+using namespace std;
+using namespace eth;
+
+/// Number of heap allocations made by the process so far.
+static atomic<uint64_t> s_allocations(0);
+
+void* operator new(size_t _n)
+{
+	s_allocations++;
+	if (void* ret = malloc(_n ? _n : 1))
+		return ret;
+	throw bad_alloc();
+}
+
+void operator delete(void* _p) noexcept
+{
+	free(_p);
+}
+
+struct Benchmark
+{
+	string name;
+	string code;		///< Assembly of the contract; executed with the loop counter pre-set by the prologue.
+};
+
+struct BenchmarkResult
+{
+	string name;
+	unsigned runs;
+	uint64_t steps;
+	uint64_t nanoseconds;
+	uint64_t allocations;
+};
+
+/// The canned contracts. Each one loops c_iterations times (the counter is kept at the bottom of the stack).
+static const unsigned c_iterations = 1000;
+
+static vector<Benchmark> corpus()
+{
+	string prologue = "PUSH " + toString(c_iterations) + " loop: ";
+	// Decrement the counter and go round again unless it's zero.
+	string epilogue = " PUSH 1 SWAP SUB DUP PUSH loop SWAP JMPI STOP";
+	string priv = toString((u256)sha3("benchmark secret"));
+	string msg = toString((u256)sha3("benchmark message"));
+
+	return vector<Benchmark>{
+		{ "arithmetic", prologue + "PUSH 3 PUSH 5 MUL PUSH 7 ADD PUSH 11 SWAP MOD PUSH 2 EXP DUP DUP LT POP POP" + epilogue },
+		{ "memory", prologue + "DUP DUP MSTORE DUP MLOAD POP" + epilogue },
+		{ "storage", prologue + "DUP DUP SSTORE DUP SLOAD POP" + epilogue },
+		{ "sha3", prologue + "DUP DUP PUSH 64 SHA3 POP" + epilogue },
+		{ "sha256", prologue + "DUP DUP PUSH 64 SHA256 POP" + epilogue },
+		{ "ripemd160", prologue + "DUP DUP PUSH 64 RIPEMD160 POP" + epilogue },
+		{ "ecrecover", prologue + "PUSH " + msg + " PUSH " + priv + " PUSH " + msg + " ECSIGN ECRECOVER POP POP" + epilogue },
+		{ "mktx", prologue + "DUP PUSH 1 PUSH 1 TXSENDER MKTX" + epilogue }
+	};
+}
+
+static BenchmarkResult run(Benchmark const& _b, unsigned _runs, bool _compiled)
+{
+	BlockInfo pb;
+	pb.hash = sha3("previousHash");
+	pb.nonce = sha3("previousNonce");
+	BlockInfo cb = pb;
+	cb.difficulty = 256;
+	cb.timestamp = 1;
+	cb.coinbaseAddress = toAddress(sha3("coinbase"));
+	FeeStructure fees;
+	fees.setMultiplier(1);
+
+	u256s code = assemble(_b.code);
+	Address contract = toAddress(sha3("contract"));
+	FakeExtVM fev(fees, pb, cb, 0);
+	fev.setContract(contract, Uether, 0, code);
+	fev.setTransaction(toAddress(sha3("sender")), ether, u256s());
+
+	BenchmarkResult ret{_b.name, _runs, 0, 0, 0};
+	VM vm;
+	for (unsigned i = 0; i < _runs; ++i)
+	{
+		fev.reset(Uether, 0, code);
+		vm.reset();
+		if (_compiled)
+			vm.setCode(CompiledCode::compile(get<3>(fev.addresses[contract])));
+
+		uint64_t allocations = s_allocations;
+		auto start = chrono::high_resolution_clock::now();
+		vm.go(fev);
+		ret.nanoseconds += chrono::duration_cast<chrono::nanoseconds>(chrono::high_resolution_clock::now() - start).count();
+		ret.allocations += s_allocations - allocations;
+		ret.steps += vm.stepCount();
+	}
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	bool json = false;
+	bool compiled = false;
+	unsigned runs = 10;
+	string only;
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "--json")
+			json = true;
+		else if (arg == "-c" || arg == "--compiled")
+			compiled = true;
+		else if ((arg == "-r" || arg == "--runs") && i + 1 < argc)
+			runs = max(1, atoi(argv[++i]));
+		else if ((arg == "-b" || arg == "--benchmark") && i + 1 < argc)
+			only = argv[++i];
+		else
+		{
+			cerr << "Usage bencheth [--json] [-c,--compiled] [-r,--runs <n>] [-b,--benchmark <name>]" << endl;
+			return -1;
+		}
+	}
+
+	g_logVerbosity = 0;
+
+	json_spirit::mArray results;
+	for (auto const& b: corpus())
+	{
+		if (!only.empty() && only != b.name)
+			continue;
+		BenchmarkResult r = run(b, runs, compiled);
+		double nsPerOp = r.steps ? (double)r.nanoseconds / r.steps : 0;
+		double opsPerSec = r.nanoseconds ? r.steps * 1e9 / r.nanoseconds : 0;
+		double allocsPerRun = (double)r.allocations / r.runs;
+		if (json)
+		{
+			json_spirit::mObject o;
+			o["name"] = r.name;
+			o["runs"] = (uint64_t)r.runs;
+			o["steps"] = r.steps;
+			o["nanoseconds"] = r.nanoseconds;
+			o["nsPerOp"] = nsPerOp;
+			o["opsPerSecond"] = opsPerSec;
+			o["allocationsPerRun"] = allocsPerRun;
+			results.push_back(o);
+		}
+		else
+			cout << left << setw(12) << r.name << right
+				<< setw(14) << (uint64_t)opsPerSec << " ops/s "
+				<< setw(10) << fixed << setprecision(1) << nsPerOp << " ns/op "
+				<< setw(12) << allocsPerRun << " allocs/run" << endl;
+	}
+	if (json)
+		cout << json_spirit::write_string(json_spirit::mValue(results), true) << endl;
+	return 0;
+}
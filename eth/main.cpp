@@ -40,6 +40,7 @@
 #include "FileSystem.h"
 #include "Instruction.h"
 #include "RLP.h"
+#include "VMProfiler.h"
 //#include "BuildInfo.h"
 using namespace std;
 using namespace eth;
@@ -72,6 +73,7 @@ void help()
         << "    -p,--port <port>  Connect to remote port (default: 30303)." << endl
         << "    -r,--remote <host>  Connect to remote host (default: none)." << endl
         << "    -s,--secret <secretkeyhex>  Set the secret key for use with send command (default: auto)." << endl
+        << "    -t,--index-transactions <on/off>  Index the chain's transactions by hash (default: as last set; initially off)." << endl
         << "    -u,--public-ip <ip>  Force public ip to given (default; auto)." << endl
         << "    -v,--verbosity <0 - 9>  Set the log verbosity from 0 to 9 (Default: 8)." << endl
         << "    -x,--peers <number>  Attempt to connect to given number of peers (Default: 5)." << endl
@@ -403,6 +405,21 @@ void runCommand(Client& c, KeyPair& us, std::istream& s_in, std::ostream& s_out)
 		Address dest = h160(fromHex(rechex));
 		c.transact(us.secret(), dest, amount);
 	}
+	else if (cmd == "estimate")
+	{
+		string rechex;
+		u256 amount;
+		s_in >> rechex >> amount;
+		Transaction t;
+		t.nonce = c.postState().transactionsFrom(us.address());
+		t.receiveAddress = h160(fromHex(rechex));
+		t.value = amount;
+		auto r = c.simulate({{t, us.address()}}).front();
+		if (r.success)
+			s_out << formatBalance(r.fee) << " (" << r.stores.size() << " contracts' storage altered)" << endl;
+		else
+			s_out << "Would fail: " << r.error << endl;
+	}
 	else if (cmd == "peers")
 	{
 		for (size_t i = 0; i < c.peers().size(); i++) {
@@ -601,10 +618,47 @@ void runCommand(Client& c, KeyPair& us, std::istream& s_in, std::ostream& s_out)
 			}
 		}
 	}
+	else if (cmd == "transaction")
+	{
+		string hash;
+		s_in >> hash;
+
+		auto const& bc = c.blockChain();
+		if (!bc.isIndexingTransactions())
+			s_out << "Transactions aren't indexed; run with --index-transactions on." << endl;
+		else if (auto a = bc.transactionAddress(h256(fromHex(hash))))
+			s_out << bc.details(a.blockHash).number << ":\t" << a.blockHash << " #" << a.index << endl;
+		else
+			s_out << "Not in the chain." << endl;
+	}
 	else if (cmd == "json:getstate")
 	{
 		getJSONState(c, s_out);
 	}
+	else if (cmd == "vm:profile")
+	{
+#if !ETH_VMTRACE
+		s_out << "VM profiling not compiled in; configure with -DVMTRACE=1." << endl;
+#endif
+		s_out << VMProfiler::get();
+	}
+	else if (cmd == "vm:profile:clear")
+	{
+		VMProfiler::get().clear();
+	}
+	else if (cmd == "vm:trace")
+	{
+		string filename;
+		s_in >> filename;
+		if (VMProfiler::get().startTrace(filename))
+			s_out << "Tracing VM execution to " << filename << endl;
+		else
+			s_out << "Couldn't open " << filename << endl;
+	}
+	else if (cmd == "vm:trace:stop")
+	{
+		VMProfiler::get().stopTrace();
+	}
 	else if (cmd == "exit")
 	{
 		exit(0);
@@ -657,6 +711,7 @@ int main(int argc, char** argv)
 	unsigned peers = 5;
 	string publicIP;
 	bool upnp = true;
+	string indexTransactions;
 	string clientName;
 
 	// Init defaults
@@ -705,6 +760,15 @@ int main(int argc, char** argv)
 				return -1;
 			}
 		}
+		else if ((arg == "-t" || arg == "--index-transactions") && i + 1 < argc)
+		{
+			indexTransactions = argv[++i];
+			if (!isTrue(indexTransactions) && !isFalse(indexTransactions))
+			{
+				cerr << "Invalid transaction index option: " << indexTransactions << endl;
+				return -1;
+			}
+		}
 		else if ((arg == "-c" || arg == "--client-name") && i + 1 < argc)
 			clientName = argv[++i];
 		else if ((arg == "-a" || arg == "--address" || arg == "--coinbase-address") && i + 1 < argc)
@@ -762,6 +826,8 @@ int main(int argc, char** argv)
 	}
 
 	Client c("Ethereum(++)/" + clientName + "v" ETH_QUOTED(ETH_VERSION) "/" ETH_QUOTED(ETH_BUILD_TYPE) "/" ETH_QUOTED(ETH_BUILD_PLATFORM), coinbase, dbPath);
+	if (!indexTransactions.empty())
+		c.setTransactionIndex(isTrue(indexTransactions));
 
 	if (network_interactive)
 	{
@@ -21,15 +21,20 @@
 
 #include "BlockChain.h"
 
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <secp256k1.h>
 #include <boost/filesystem.hpp>
 #include "Common.h"
-#include "RLP.h"
+#include "RLPSchema.h"
 #include "Exceptions.h"
 #include "Dagger.h"
 #include "BlockInfo.h"
 #include "State.h"
 #include "FileSystem.h"
 #include "Defaults.h"
+#include <leveldb/write_batch.h>
 using namespace std;
 using namespace eth;
 
@@ -42,7 +47,7 @@ std::ostream& operator<<(std::ostream& _out, BlockChain const& _bc)
 	string cmp = toBigEndianString(_bc.m_lastBlockHash);
 	auto it = _bc.m_detailsDB->NewIterator(_bc.m_readOptions);
 	for (it->SeekToFirst(); it->Valid(); it->Next())
-		if (it->key().ToString() != "best")
+		if (it->key().size() == 32)
 		{
 			BlockDetails d(RLP(it->value().ToString()));
 			_out << toHex(it->key().ToString()) << ":   " << d.number << " @ " << d.parent << (cmp == it->key().ToString() ? "  BEST" : "") << std::endl;
@@ -52,20 +57,59 @@ std::ostream& operator<<(std::ostream& _out, BlockChain const& _bc)
 }
 }
 
+/// The key under which the details DB has the hash of the block numbered @a _n on the longest chain. Unlike the keys
+/// of the blocks' own details it isn't 32 bytes long, and being big-endian, the numbers iterate in order.
+static string numberKey(eth::uint _n)
+{
+	string ret(8, '\0');
+	toBigEndian(_n, ret);
+	return "n" + ret;
+}
+
+/// The key under which the details DB has the TransactionAddress of the transaction of hash @a _h.
+static string transactionKey(h256 _h)
+{
+	return "t" + string((char const*)_h.data(), 32);
+}
+
+typedef RLPSchema<
+	ETH_RLP_FIELD(BlockDetails, number),
+	ETH_RLP_FIELD(BlockDetails, totalDifficulty),
+	ETH_RLP_FIELD(BlockDetails, parent),
+	ETH_RLP_FIELD(BlockDetails, children)
+> BlockDetailsSchema;
+
 BlockDetails::BlockDetails(RLP const& _r)
 {
-	number = _r[0].toInt<uint>();
-	totalDifficulty = _r[1].toInt<u256>();
-	parent = _r[2].toHash<h256>();
-	children = _r[3].toVector<h256>();
+	BlockDetailsSchema::decode(_r, *this);
 }
 
 bytes BlockDetails::rlp() const
 {
-	return rlpList(number, totalDifficulty, parent, children);
+	RLPStream s;
+	BlockDetailsSchema::encode(s, *this);
+	return s.out();
+}
+
+typedef RLPSchema<
+	ETH_RLP_FIELD(TransactionAddress, blockHash),
+	ETH_RLP_FIELD(TransactionAddress, index)
+> TransactionAddressSchema;
+
+TransactionAddress::TransactionAddress(RLP const& _r)
+{
+	TransactionAddressSchema::decode(_r, *this);
 }
 
-BlockChain::BlockChain(std::string _path, bool _killExisting)
+bytes TransactionAddress::rlp() const
+{
+	RLPStream s;
+	TransactionAddressSchema::encode(s, *this);
+	return s.out();
+}
+
+BlockChain::BlockChain(std::string _path, bool _killExisting):
+	m_cacheStats{0, 0, 0, 0, c_defaultCacheLimit}
 {
 	if (_path.empty())
 		_path = Defaults::get()->m_dbPath;
@@ -85,7 +129,7 @@ BlockChain::BlockChain(std::string _path, bool _killExisting)
 
 	// Initialise with the genesis as the last block on the longest chain.
 	m_genesisHash = BlockInfo::genesis().hash;
-	m_genesisBlock = BlockInfo::createGenesisBlock();
+	m_genesisBlock = make_shared<string const>(asString(BlockInfo::createGenesisBlock()));
 
 	if (!details(m_genesisHash))
 	{
@@ -95,18 +139,72 @@ BlockChain::BlockChain(std::string _path, bool _killExisting)
 		m_detailsDB->Put(m_writeOptions, ldb::Slice((char const*)&m_genesisHash, 32), (ldb::Slice)eth::ref(r));
 	}
 
-	checkConsistency();
+	// A clean shutdown leaves a marker and nothing needs checking. Otherwise just the journalled blocks may be out of
+	// step, unless there's no journal either (the DB predates it), in which case it all has to be checked.
+	std::string clean;
+	std::string journal;
+	m_detailsDB->Get(m_readOptions, ldb::Slice("clean"), &clean);
+	if (clean.empty())
+	{
+		m_detailsDB->Get(m_readOptions, ldb::Slice("journal"), &journal);
+		clog(BlockChainNote) << "Blockchain DB not closed cleanly; checking" << (journal.empty() ? "all blocks." : "journal.");
+		bool ok = journal.empty() ? checkConsistency() : checkJournal(bytesConstRef(&journal));
+		if (!ok)
+		{
+			cwarn << "Blockchain DB is inconsistent.";
+			m_inconsistent = true;
+		}
+		assert(ok);
+	}
+
+	// Until we're closed, the DB is unclean. Whatever's in it now has been checked, so make sure it stays. If it
+	// didn't check out, the journal goes, so that every block gets checked again next time.
+	{
+		ldb::WriteOptions o;
+		o.sync = true;
+		ldb::WriteBatch none;
+		m_db->Write(o, &none);
+		ldb::WriteBatch batch;
+		batch.Delete(ldb::Slice("clean"));
+		auto j = rlp(m_journal);
+		if (m_inconsistent)
+			batch.Delete(ldb::Slice("journal"));
+		else
+			batch.Put(ldb::Slice("journal"), (ldb::Slice)eth::ref(j));
+		m_detailsDB->Write(o, &batch);
+	}
 
 	// TODO: Implement ability to rebuild details map from DB.
 	std::string l;
 	m_detailsDB->Get(m_readOptions, ldb::Slice("best"), &l);
 	m_lastBlockHash = l.empty() ? m_genesisHash : *(h256*)l.data();
 
+	std::string t;
+	m_detailsDB->Get(m_readOptions, ldb::Slice("txs"), &t);
+	m_indexTransactions = !t.empty();
+
+	// Index whatever of the longest chain isn't already; for a DB that predates the index, that's all of it.
+	{
+		ldb::WriteBatch batch;
+		noteBest(m_lastBlockHash, batch);
+		m_detailsDB->Write(m_writeOptions, &batch);
+	}
+
 	cout << "Opened blockchain db. Latest: " << m_lastBlockHash << endl;
 }
 
 BlockChain::~BlockChain()
 {
+	// Make sure the blocks are on disk before saying that everything is.
+	ldb::WriteOptions o;
+	o.sync = true;
+	ldb::WriteBatch none;
+	m_db->Write(o, &none);
+	if (!m_inconsistent)
+		m_detailsDB->Put(o, ldb::Slice("clean"), ldb::Slice("1"));
+
+	delete m_detailsDB;
+	delete m_db;
 }
 
 template <class T, class V>
@@ -136,24 +234,113 @@ bool BlockChain::attemptImport(bytes const& _block, Overlay const& _stateDB)
 }
 
 
-void BlockChain::import(bytes const& _block, Overlay const& _db)
+VerifiedBlock BlockChain::verify(bytesConstRef _block)
 {
-	// VERIFY: populates from the block and checks the block is internally coherent.
-	BlockInfo bi(&_block);
-#if ETH_CATCH
+	VerifiedBlock ret;
+	ret.block = _block;
+	ret.hash = eth::sha3(_block);
 	try
+	{
+		// VERIFY: populates from the block and checks the block is internally coherent.
+		ret.info.populate(_block);
+#if ETH_CATCH
+		try
 #endif
+		{
+			ret.info.verifyInternals(_block);
+		}
+#if ETH_CATCH
+		catch (Exception const& _e)
+		{
+			clog(BlockChainNote) << "   Malformed block (" << _e.description() << ").";
+			throw;
+		}
+#endif
+
+		// Recovering the senders is most of the work of checking the transactions' signatures; a transaction that's
+		// malformed is left for when it's executed to fail.
+		for (auto const& i: RLP(_block)[1])
+			try
+			{
+				ret.senders.push_back(Transaction(i.data()).safeSender());
+			}
+			catch (...)
+			{
+				ret.senders.push_back(Address());
+			}
+	}
+	catch (...)
 	{
-		bi.verifyInternals(&_block);
+		ret.error = current_exception();
 	}
-#if ETH_CATCH
-	catch (Exception const& _e)
+	return ret;
+}
+
+vector<ImportResult> BlockChain::import(vector<bytes> const& _blocks, Overlay const& _stateDB)
+{
+	// Verifying a block needs nothing but the block, so the blocks are verified on other threads, in order, ahead of
+	// being imported here in turn.
+	secp256k1_start();
+	vector<VerifiedBlock> verified(_blocks.size());
+	vector<char> ready(_blocks.size(), false);
+	mutex x;
+	condition_variable cv;
+	atomic<size_t> next(0);
+	auto work = [&]()
 	{
-		clog(BlockChainNote) << "   Malformed block (" << _e.description() << ").";
-		throw;
+		for (size_t i; (i = next++) < _blocks.size();)
+		{
+			auto v = verify(&_blocks[i]);
+			lock_guard<mutex> l(x);
+			verified[i] = move(v);
+			ready[i] = true;
+			cv.notify_all();
+		}
+	};
+	unsigned threads = (unsigned)min<size_t>(max(thread::hardware_concurrency(), 2u) - 1, _blocks.size());
+	vector<thread> workers;
+	for (unsigned i = 0; i < threads; ++i)
+		workers.push_back(thread(work));
+
+	vector<ImportResult> ret;
+	ret.reserve(_blocks.size());
+	for (size_t i = 0; i < _blocks.size(); ++i)
+	{
+		{
+			unique_lock<mutex> l(x);
+			cv.wait(l, [&](){ return ready[i]; });
+		}
+		try
+		{
+			import(verified[i], _stateDB);
+			ret.push_back(ImportResult::Imported);
+		}
+		catch (AlreadyHaveBlock)
+		{
+			ret.push_back(ImportResult::AlreadyHave);
+		}
+		catch (UnknownParent)
+		{
+			ret.push_back(ImportResult::UnknownParent);
+		}
+		catch (...)
+		{
+			ret.push_back(ImportResult::Bad);
+		}
+		verified[i] = VerifiedBlock();
 	}
-#endif
-	auto newHash = eth::sha3(_block);
+
+	for (auto& w: workers)
+		w.join();
+	return ret;
+}
+
+void BlockChain::import(VerifiedBlock const& _block, Overlay const& _db)
+{
+	if (_block.error)
+		rethrow_exception(_block.error);
+	auto const& bi = _block.info;
+	auto newHash = _block.hash;
 
 	// Check block doesn't already exist first!
 	if (details(newHash))
@@ -174,6 +361,7 @@ void BlockChain::import(bytes const& _block, Overlay const& _db)
 	clog(BlockChainNote) << "Attempting import of " << newHash << "...";
 
 	u256 td;
+	bool isBest = false;
 #if ETH_CATCH
 	try
 #endif
@@ -183,16 +371,28 @@ void BlockChain::import(bytes const& _block, Overlay const& _db)
 		bi.verifyParent(biParent);
 
 		// Check transactions are valid and that they result in a state equivalent to our state_root.
-		State s(bi.coinbaseAddress, _db);
-		s.sync(*this, bi.parentHash);
+		// The state kept from the last import is usually the parent's already, so only needs syncing on a fork. It's
+		// made afresh only if there's none: when we've just started, or the last import failed part way through.
+		unique_ptr<State> s = move(m_importState);
+		if (!s)
+		{
+			s.reset(new State(bi.coinbaseAddress, _db));
+			s->sync(*this, bi.parentHash);
+		}
+		else if (m_importStateBlock != bi.parentHash)
+			s->sync(*this, bi.parentHash);
 
 		// Get total difficulty increase and update state, checking it.
 		BlockInfo biGrandParent;
 		if (pd.number)
 			biGrandParent.populate(block(pd.parent));
-		auto tdIncrease = s.playback(&_block, bi, biParent, biGrandParent, true);
+		auto tdIncrease = s->playback(_block.block, bi, biParent, biGrandParent, true, _block.senders);
 		td = pd.totalDifficulty + tdIncrease;
 
+		// It's now the state of this block, ready for the next.
+		m_importState = move(s);
+		m_importStateBlock = newHash;
+
 #if ETH_PARANOIA
 		checkConsistency();
 #endif
@@ -203,9 +403,33 @@ void BlockChain::import(bytes const& _block, Overlay const& _db)
 			m_details[bi.parentHash].children.push_back(newHash);
 		}
 
-		m_detailsDB->Put(m_writeOptions, ldb::Slice((char const*)&newHash, 32), (ldb::Slice)eth::ref(m_details[newHash].rlp()));
-		m_detailsDB->Put(m_writeOptions, ldb::Slice((char const*)&bi.parentHash, 32), (ldb::Slice)eth::ref(m_details[bi.parentHash].rlp()));
-		m_db->Put(m_writeOptions, ldb::Slice((char const*)&newHash, 32), (ldb::Slice)ref(_block));
+		// This might be the new last block...
+		isBest = td > details(m_lastBlockHash).totalDifficulty;
+
+		// The block goes in first, so that any details written refer only to blocks we have. The details of the block
+		// and its parent go in together with the journal and, if it's now best, the number index. Every so often
+		// both are written synchronously, after which the journal can start again.
+		m_journal.push_back(newHash);
+		ldb::WriteOptions o = m_writeOptions;
+		o.sync = m_journal.size() >= c_journalLength;
+		if (o.sync)
+			m_journal.clear();
+		m_db->Put(o, ldb::Slice((char const*)&newHash, 32), (ldb::Slice)_block.block);
+
+		ldb::WriteBatch batch;
+		auto nd = m_details[newHash].rlp();
+		auto pd = m_details[bi.parentHash].rlp();
+		auto j = rlp(m_journal);
+		batch.Put(ldb::Slice((char const*)&newHash, 32), (ldb::Slice)eth::ref(nd));
+		batch.Put(ldb::Slice((char const*)&bi.parentHash, 32), (ldb::Slice)eth::ref(pd));
+		if (!m_inconsistent)
+			batch.Put(ldb::Slice("journal"), (ldb::Slice)eth::ref(j));
+		if (isBest)
+		{
+			batch.Put(ldb::Slice("best"), ldb::Slice((char const*)&newHash, 32));
+			noteBest(newHash, batch);
+		}
+		m_detailsDB->Write(o, &batch);
 
 #if ETH_PARANOIA
 		checkConsistency();
@@ -221,11 +445,9 @@ void BlockChain::import(bytes const& _block, Overlay const& _db)
 
 //	cnote << "Parent " << bi.parentHash << " has " << details(bi.parentHash).children.size() << " children.";
 
-	// This might be the new last block...
-	if (td > details(m_lastBlockHash).totalDifficulty)
+	if (isBest)
 	{
 		m_lastBlockHash = newHash;
-		m_detailsDB->Put(m_writeOptions, ldb::Slice("best"), ldb::Slice((char const*)&newHash, 32));
 		clog(BlockChainNote) << "   Imported and best. Has" << (details(bi.parentHash).children.size() - 1) << "siblings.";
 	}
 	else
@@ -234,39 +456,234 @@ void BlockChain::import(bytes const& _block, Overlay const& _db)
 	}
 }
 
-void BlockChain::checkConsistency()
+void BlockChain::noteBest(h256 _best, ldb::WriteBatch& io_batch) const
 {
-	m_details.clear();
+	// Back from the new best until we reach a block that's already indexed: the rest of the chain is shared.
+	h256s added;
+	for (h256 h = _best; h && hashFromNumber(details(h).number) != h; h = details(h).parent)
+		added.push_back(h);
+
+	// The old chain from there on is no longer the longest. It may have been longer than the new one, so anything
+	// indexed beyond the new best goes altogether. Its transactions go first, since the new chain may have some of
+	// them too.
+	auto bestNumber = details(_best).number;
+	for (auto n = added.size() ? details(added.back()).number : bestNumber + 1; h256 old = hashFromNumber(n); ++n)
+	{
+		if (m_indexTransactions)
+			noteTransactions(old, false, io_batch);
+		if (n > bestNumber)
+			io_batch.Delete(ldb::Slice(numberKey(n)));
+	}
+
+	for (auto h = added.rbegin(); h != added.rend(); ++h)
+	{
+		io_batch.Put(ldb::Slice(numberKey(details(*h).number)), ldb::Slice((char const*)h->data(), 32));
+		if (m_indexTransactions)
+			noteTransactions(*h, true, io_batch);
+	}
+}
+
+void BlockChain::noteTransactions(h256 _block, bool _add, ldb::WriteBatch& io_batch) const
+{
+	// A transaction's hash is that of its RLP, which the block has as it is; there's no need to decode it.
+	auto b = block(_block);
+	eth::uint index = 0;
+	for (auto const& tx: RLP(b)[1])
+	{
+		auto k = transactionKey(sha3(tx.data()));
+		if (_add)
+		{
+			auto a = TransactionAddress(_block, index).rlp();
+			io_batch.Put(ldb::Slice(k), (ldb::Slice)eth::ref(a));
+		}
+		else
+			io_batch.Delete(ldb::Slice(k));
+		++index;
+	}
+}
+
+TransactionAddress BlockChain::transactionAddress(h256 _transactionHash) const
+{
+	if (!m_indexTransactions)
+		return TransactionAddress();
+	std::string s;
+	m_detailsDB->Get(m_readOptions, ldb::Slice(transactionKey(_transactionHash)), &s);
+	return s.empty() ? TransactionAddress() : TransactionAddress(RLP(s));
+}
+
+void BlockChain::setTransactionIndex(bool _on)
+{
+	if (_on == m_indexTransactions)
+		return;
+
+	// The marker goes last when turning on and first when turning off, so it's only ever there if the index is whole.
+	if (_on)
+	{
+		for (eth::uint n = 0;; n += 1024)
+		{
+			ldb::WriteBatch batch;
+			auto hs = hashesFromNumbers(n, 1024);
+			for (auto const& h: hs)
+				noteTransactions(h, true, batch);
+			m_detailsDB->Write(m_writeOptions, &batch);
+			if (hs.size() < 1024)
+				break;
+		}
+		m_detailsDB->Put(m_writeOptions, ldb::Slice("txs"), ldb::Slice("1"));
+	}
+	else
+	{
+		m_detailsDB->Delete(m_writeOptions, ldb::Slice("txs"));
+		ldb::WriteBatch batch;
+		ldb::Iterator* it = m_detailsDB->NewIterator(m_readOptions);
+		for (it->Seek(ldb::Slice("t")); it->Valid() && it->key().size() && it->key().data()[0] == 't'; it->Next())
+			if (it->key().size() == 33)
+				batch.Delete(it->key());
+		delete it;
+		m_detailsDB->Write(m_writeOptions, &batch);
+	}
+	m_indexTransactions = _on;
+}
+
+h256 BlockChain::hashFromNumber(eth::uint _n) const
+{
+	std::string s;
+	m_detailsDB->Get(m_readOptions, ldb::Slice(numberKey(_n)), &s);
+	return s.size() == 32 ? h256((byte const*)s.data(), h256::ConstructFromPointer) : h256();
+}
+
+h256s BlockChain::hashesFromNumbers(eth::uint _n, eth::uint _count) const
+{
+	h256s ret;
+	ret.reserve((size_t)min<eth::uint>(_count, 4096));
+	ldb::Iterator* it = m_detailsDB->NewIterator(m_readOptions);
+	// The index's keys come in order of number, but the details of any block whose hash happens to begin with the
+	// same byte are mixed in amongst them, so get skipped.
+	for (it->Seek(ldb::Slice(numberKey(_n))); ret.size() < _count && it->Valid() && it->key().size() && it->key().data()[0] == 'n'; it->Next())
+		if (it->key().size() == 9)
+		{
+			if (it->key().ToString() != numberKey(_n + ret.size()) || it->value().size() != 32)
+				break;
+			ret.push_back(h256((byte const*)it->value().data(), h256::ConstructFromPointer));
+		}
+	delete it;
+	return ret;
+}
+
+bool BlockChain::checkLinkage(h256 _h, BlockDetails const& _d, BlockDetails const& _parent)
+{
+	if (_d.parent != h256() && (!contains(_parent.children, _h) || _parent.number != _d.number - 1))
+	{
+		cwarn << "Inconsistent blockchain DB: block" << _h << "doesn't fit with its parent" << _d.parent;
+		return false;
+	}
+	return true;
+}
+
+bool BlockChain::checkConsistency(unsigned _threads) const
+{
+	// Read everything in one sequential pass rather than looking up each parent.
+	std::map<h256, BlockDetails> all;
 	ldb::Iterator* it = m_detailsDB->NewIterator(m_readOptions);
 	for (it->SeekToFirst(); it->Valid(); it->Next())
 		if (it->key().size() == 32)
+			all.insert(make_pair(h256((byte const*)it->key().data(), h256::ConstructFromPointer), BlockDetails(RLP(bytesConstRef((byte const*)it->value().data(), it->value().size())))));
+	delete it;
+
+	vector<std::map<h256, BlockDetails>::const_iterator> todo;
+	todo.reserve(all.size());
+	for (auto i = all.cbegin(); i != all.cend(); ++i)
+		todo.push_back(i);
+
+	if (!_threads)
+		_threads = max(1u, thread::hardware_concurrency());
+	atomic<bool> ok(true);
+	auto check = [&](size_t _begin, size_t _end)
+	{
+		for (size_t i = _begin; i < _end; ++i)
 		{
-			h256 h((byte const*)it->key().data(), h256::ConstructFromPointer);
-			auto dh = details(h);
-			auto p = dh.parent;
-			if (p != h256())
-			{
-				auto dp = details(p);
-				assert(contains(dp.children, h));
-				assert(dp.number == dh.number - 1);
-			}
+			auto p = all.find(todo[i]->second.parent);
+			if (!checkLinkage(todo[i]->first, todo[i]->second, p == all.end() ? NullBlockDetails : p->second))
+				ok = false;
 		}
-	delete it;
+	};
+	vector<thread> workers;
+	size_t chunk = (todo.size() + _threads - 1) / _threads;
+	for (size_t b = chunk; b < todo.size(); b += chunk)
+		workers.push_back(thread(check, b, min(b + chunk, todo.size())));
+	check(0, min(chunk, todo.size()));
+	for (auto& w: workers)
+		w.join();
+	return ok;
+}
+
+bool BlockChain::checkJournal(bytesConstRef _journal) const
+{
+	bool ok = true;
+	for (auto const& h: RLP(_journal).toVector<h256>())
+	{
+		string b;
+		m_db->Get(m_readOptions, ldb::Slice((char const*)&h, 32), &b);
+		auto const& d = details(h);
+		if (b.empty() || !d)
+		{
+			cwarn << "Inconsistent blockchain DB: journalled block" << h << "is missing.";
+			ok = false;
+		}
+		else if (!checkLinkage(h, d, details(d.parent)))
+			ok = false;
+	}
+	return ok;
 }
 
-bytesConstRef BlockChain::block(h256 _hash) const
+CachedBlock BlockChain::block(h256 _hash) const
 {
 	if (_hash == m_genesisHash)
-		return &m_genesisBlock;
+		return CachedBlock(m_genesisBlock);
+
+	{
+		lock_guard<mutex> l(m_lock);
+		auto it = m_cache.find(_hash);
+		if (it != m_cache.end())
+		{
+			m_cacheStats.hits++;
+			m_cacheOrder.splice(m_cacheOrder.begin(), m_cacheOrder, it->second.second);
+			return CachedBlock(it->second.first);
+		}
+		m_cacheStats.misses++;
+	}
 
 	string d;
 	m_db->Get(m_readOptions, ldb::Slice((char const*)&_hash, 32), &d);
+	if (d.empty())
+		return CachedBlock();
+	auto data = make_shared<string const>(move(d));
 
 	{
 		lock_guard<mutex> l(m_lock);
-		swap(m_cache[_hash], d);
-		return bytesConstRef(&m_cache[_hash]);
+		// Another thread may have got here first.
+		if (!m_cache.count(_hash))
+		{
+			m_cacheOrder.push_front(_hash);
+			m_cache[_hash] = make_pair(data, m_cacheOrder.begin());
+			m_cacheStats.size += data->size();
+			evictBlocks();
+		}
+	}
+	return CachedBlock(data);
+}
+
+void BlockChain::evictBlocks() const
+{
+	while (m_cacheStats.size > m_cacheLimit && m_cacheOrder.size())
+	{
+		auto it = m_cache.find(m_cacheOrder.back());
+		m_cacheStats.size -= it->second.first->size();
+		m_cacheStats.evictions++;
+		m_cache.erase(it);
+		m_cacheOrder.pop_back();
 	}
+	m_cacheStats.limit = m_cacheLimit;
 }
 
 BlockDetails const& BlockChain::details(h256 _h) const
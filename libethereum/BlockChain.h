@@ -22,9 +22,13 @@
 #pragma once
 
 #include <mutex>
+#include <list>
+#include <memory>
+#include <exception>
 #include "CommonEth.h"
 #include "Log.h"
 #include "AddressState.h"
+#include "BlockInfo.h"
 namespace ldb = leveldb;
 
 namespace eth
@@ -51,10 +55,80 @@ struct BlockDetails
 
 typedef std::map<h256, BlockDetails> BlockDetailsHash;
 
+/// Where a transaction is on the longest chain: its block and its place in that block's list of transactions.
+struct TransactionAddress
+{
+	TransactionAddress(): index(0) {}
+	TransactionAddress(h256 _b, uint _i): blockHash(_b), index(_i) {}
+	TransactionAddress(RLP const& _r);
+	bytes rlp() const;
+
+	bool isNull() const { return !blockHash; }
+	explicit operator bool() const { return !isNull(); }
+
+	h256 blockHash;
+	uint index;
+};
+
+/**
+ * @brief The RLP of a block, as given out by BlockChain::block().
+ * Shares the data with the block cache; it stays valid for as long as this is kept, even once the cache has let it go.
+ */
+class CachedBlock
+{
+public:
+	CachedBlock() {}
+	explicit CachedBlock(std::shared_ptr<std::string const> const& _data): m_data(_data) {}
+
+	bytesConstRef ref() const { return m_data ? bytesConstRef((byte const*)m_data->data(), m_data->size()) : bytesConstRef(); }
+	operator bytesConstRef() const { return ref(); }
+
+	byte const* data() const { return ref().data(); }
+	size_t size() const { return m_data ? m_data->size() : 0; }
+	bool empty() const { return !size(); }
+	bytes toBytes() const { return ref().toBytes(); }
+
+private:
+	std::shared_ptr<std::string const> m_data;
+};
+
+/// How the block cache is doing.
+struct BlockCacheStats
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	size_t size;		///< Total bytes of the blocks currently cached.
+	size_t limit;		///< Most bytes the cache will hold.
+};
+
+/**
+ * @brief A block as checked by BlockChain::verify(): all that can be done with nothing but the block itself.
+ * Refers to the block's RLP, which must outlive it.
+ */
+struct VerifiedBlock
+{
+	bytesConstRef block;
+	h256 hash;
+	BlockInfo info;
+	Addresses senders;			///< The sender of each of its transactions, or null if it couldn't be recovered.
+	std::exception_ptr error;	///< Why it's malformed, if it is.
+};
+
+/// What became of each block given to BlockChain::import().
+enum class ImportResult
+{
+	Imported,
+	AlreadyHave,
+	UnknownParent,
+	Bad
+};
+
 static const BlockDetails NullBlockDetails;
 static const h256s NullH256s;
 
 class Overlay;
+class State;
 
 class AlreadyHaveBlock: public std::exception {};
 class UnknownParent: public std::exception {};
@@ -80,15 +154,38 @@ public:
 	bool attemptImport(bytes const& _block, Overlay const& _stateDB);
 
 	/// Import block into disk-backed DB
-	void import(bytes const& _block, Overlay const& _stateDB);
+	void import(bytes const& _block, Overlay const& _stateDB) { import(verify(&_block), _stateDB); }
+
+	/// Import a block already verified. @a _stateDB should be the same each time; the state of the last block imported
+	/// is kept in it for the next.
+	/// @throws AlreadyHaveBlock, UnknownParent or whatever made it malformed or invalid.
+	void import(VerifiedBlock const& _block, Overlay const& _stateDB);
+
+	/// Import each of @a _blocks in turn. Later blocks are verified and their senders recovered on other threads
+	/// while earlier ones are executed.
+	/// @returns what became of each.
+	std::vector<ImportResult> import(std::vector<bytes> const& _blocks, Overlay const& _stateDB);
+
+	/// Decode and check the block @a _block as far as can be done without the chain, recovering the sender of each of
+	/// its transactions. Thread-safe.
+	static VerifiedBlock verify(bytesConstRef _block);
 
 	/// Get the number of the last block of the longest chain.
 	BlockDetails const& details(h256 _hash) const;
 	BlockDetails const& details() const { return details(currentHash()); }
 
-	/// Get a given block (RLP format). Thread-safe.
-	bytesConstRef block(h256 _hash) const;
-	bytesConstRef block() const { return block(currentHash()); }
+	/// Get a given block (RLP format), or empty if we don't have it. Thread-safe.
+	CachedBlock block(h256 _hash) const;
+	CachedBlock block() const { return block(currentHash()); }
+
+	/// Set the most bytes of blocks to keep in memory; the least recently used go first.
+	void setCacheLimit(size_t _bytes) { std::lock_guard<std::mutex> l(m_lock); m_cacheLimit = _bytes; evictBlocks(); }
+
+	/// @returns the hit, miss and eviction counts and the current size of the block cache.
+	BlockCacheStats cacheStats() const { std::lock_guard<std::mutex> l(m_lock); return m_cacheStats; }
+
+	/// Most bytes of blocks kept in memory unless set otherwise.
+	static const size_t c_defaultCacheLimit = 32 * 1024 * 1024;
 
 	/// Get a given block (RLP format). Thread-safe.
 	h256 currentHash() const { return m_lastBlockHash; }
@@ -96,16 +193,62 @@ public:
 	/// Get the hash of the genesis block.
 	h256 genesisHash() const { return m_genesisHash; }
 
+	/// @returns the hash of the block numbered @a _n on the longest chain, or h256() if the chain isn't that long.
+	/// Thread-safe.
+	h256 hashFromNumber(uint _n) const;
+
+	/// @returns the hashes of the blocks numbered @a _n, @a _n + 1, ... on the longest chain; @a _count of them, or
+	/// fewer if the chain ends first. Thread-safe.
+	h256s hashesFromNumbers(uint _n, uint _count) const;
+
+	/// @returns where the transaction of hash @a _transactionHash is on the longest chain, or a null address if it's
+	/// not there or transactions aren't being indexed. Thread-safe.
+	TransactionAddress transactionAddress(h256 _transactionHash) const;
+
+	/// Turn the index of transactions by hash on or off. It's off unless turned on, and stays as it was last set on
+	/// the DB. Turning it on indexes the whole chain; turning it off deletes the index. Not to be called during import.
+	void setTransactionIndex(bool _on);
+	bool isIndexingTransactions() const { return m_indexTransactions; }
+
 	std::vector<std::pair<Address, AddressState>> interestQueue() { std::vector<std::pair<Address, AddressState>> ret; swap(ret, m_interestQueue); return ret; }
 	void pushInterest(Address _a) { m_interest[_a]++; }
 	void popInterest(Address _a) { if (m_interest[_a] > 1) m_interest[_a]--; else if (m_interest[_a]) m_interest.erase(_a); }
 
+	/// Check every block's details against its parent's, spreading the work over @a _threads threads (by default, one
+	/// per core). Needed at startup only if the DB wasn't closed cleanly and has no journal.
+	/// @returns true if all is consistent.
+	bool checkConsistency(unsigned _threads = 0) const;
+
+	/// Blocks imported between each synchronous write of the DBs, and so at most the number in the journal.
+	static const unsigned c_journalLength = 64;
+
 private:
-	void checkConsistency();
+	/// Check just the blocks in the journal: those imported since the DBs were last written synchronously.
+	/// @returns true if all is consistent.
+	bool checkJournal(bytesConstRef _journal) const;
+
+	/// Check the details @a _d of block @a _h against those of its parent, @a _parent.
+	static bool checkLinkage(h256 _h, BlockDetails const& _d, BlockDetails const& _parent);
+
+	/// Add to @a io_batch what's needed to bring the number index into line with @a _best being the last block of the
+	/// longest chain: that is, back as far as the block where it joins the chain previously indexed.
+	void noteBest(h256 _best, ldb::WriteBatch& io_batch) const;
+
+	/// Add to @a io_batch the index entries of the transactions in block @a _block, or if not @a _add, their deletion.
+	void noteTransactions(h256 _block, bool _add, ldb::WriteBatch& io_batch) const;
+
+	/// Drop the least recently used blocks until the cache is within its limit. Must hold m_lock.
+	void evictBlocks() const;
 
 	/// Get fully populated from disk DB.
 	mutable BlockDetailsHash m_details;
-	mutable std::map<h256, std::string> m_cache;
+
+	/// Recently used blocks, each with its place in m_cacheOrder, which runs from most to least recently used.
+	mutable std::map<h256, std::pair<std::shared_ptr<std::string const>, std::list<h256>::iterator>> m_cache;
+	mutable std::list<h256> m_cacheOrder;
+	mutable BlockCacheStats m_cacheStats;
+	size_t m_cacheLimit = c_defaultCacheLimit;
+
 	mutable std::mutex m_lock;
 
 	/// The queue of transactions that have happened that we're interested in.
@@ -115,10 +258,25 @@ private:
 	ldb::DB* m_db;
 	ldb::DB* m_detailsDB;
 
+	/// Blocks imported since the DBs were last written synchronously; kept in the details DB alongside them.
+	h256s m_journal;
+
+	/// True if the DB didn't check out when opened. It's then never marked clean, nor given a journal, so it's checked
+	/// in full each time it's opened until it does.
+	bool m_inconsistent = false;
+
+	/// The state as of the last block imported, m_importStateBlock, from which to import the next. Null if the last
+	/// import failed part way through.
+	std::unique_ptr<State> m_importState;
+	h256 m_importStateBlock;
+
+	/// Whether the details DB also indexes the transactions of the longest chain by hash.
+	bool m_indexTransactions = false;
+
 	/// Hash of the last (valid) block on the longest chain.
 	h256 m_lastBlockHash;
 	h256 m_genesisHash;
-	bytes m_genesisBlock;
+	std::shared_ptr<std::string const> m_genesisBlock;
 
 	ldb::ReadOptions m_readOptions;
 	ldb::WriteOptions m_writeOptions;
@@ -22,7 +22,7 @@
 #include "Common.h"
 #include "Dagger.h"
 #include "Exceptions.h"
-#include "RLP.h"
+#include "RLPSchema.h"
 #include "State.h"
 #include "BlockInfo.h"
 using namespace std;
@@ -30,6 +30,18 @@ using namespace eth;
 
 BlockInfo* BlockInfo::s_genesis = nullptr;
 
+typedef RLPSchema<
+	ETH_RLP_FIELD(BlockInfo, parentHash),
+	ETH_RLP_FIELD(BlockInfo, sha3Uncles),
+	ETH_RLP_FIELD(BlockInfo, coinbaseAddress),
+	ETH_RLP_FIELD(BlockInfo, stateRoot),
+	ETH_RLP_FIELD(BlockInfo, sha3Transactions),
+	ETH_RLP_FIELD(BlockInfo, difficulty),
+	ETH_RLP_FIELD(BlockInfo, timestamp),
+	ETH_RLP_FIELD(BlockInfo, extraData),
+	ETH_RLP_FIELD(BlockInfo, nonce)
+> BlockHeaderSchema;
+
 BlockInfo::BlockInfo(): timestamp(Invalid256)
 {
 }
@@ -69,15 +81,19 @@ bytes BlockInfo::createGenesisBlock()
 h256 BlockInfo::headerHashWithoutNonce() const
 {
 	RLPStream s;
+	s.reserve(rlpSize(false));
 	fillStream(s, false);
 	return sha3(s.out());
 }
 
 void BlockInfo::fillStream(RLPStream& _s, bool _nonce) const
 {
-	_s.appendList(_nonce ? 9 : 8) << parentHash << sha3Uncles << coinbaseAddress << stateRoot << sha3Transactions << difficulty << timestamp << extraData;
-	if (_nonce)
-		_s << nonce;
+	BlockHeaderSchema::encode(_s, *this, _nonce ? BlockHeaderSchema::c_items : BlockHeaderSchema::c_items - 1);
+}
+
+eth::uint BlockInfo::rlpSize(bool _nonce) const
+{
+	return BlockHeaderSchema::size(*this, _nonce ? BlockHeaderSchema::c_items : BlockHeaderSchema::c_items - 1);
 }
 
 void BlockInfo::populateGenesis()
@@ -91,15 +107,7 @@ void BlockInfo::populateFromHeader(RLP const& _header)
 	int field = 0;
 	try
 	{
-		parentHash = _header[field = 0].toHash<h256>();
-		sha3Uncles = _header[field = 1].toHash<h256>();
-		coinbaseAddress = _header[field = 2].toHash<Address>();
-		stateRoot = _header[field = 3].toHash<h256>();
-		sha3Transactions = _header[field = 4].toHash<h256>();
-		difficulty = _header[field = 5].toInt<u256>();
-		timestamp = _header[field = 6].toInt<u256>();
-		extraData = _header[field = 7].toBytes();
-		nonce = _header[field = 8].toHash<h256>();
+		BlockHeaderSchema::decode(_header, *this, field);
 	}
 	catch (RLPException const&)
 	{
@@ -73,6 +73,8 @@ public:
 	/// No-nonce sha3 of the header only.
 	h256 headerHashWithoutNonce() const;
 	void fillStream(RLPStream& _s, bool _nonce) const;
+	/// @returns the number of bytes fillStream() writes.
+	uint rlpSize(bool _nonce) const;
 
 	static bytes createGenesisBlock();
 
@@ -55,6 +55,7 @@ Client::Client(std::string const& _clientVersion, Address _us, std::string const
 	m_vc(_dbPath, PeerServer::protocolVersion()),
 	m_bc(_dbPath, !m_vc.ok()),
 	m_stateDB(State::openDB(_dbPath, !m_vc.ok())),
+	m_checkpoints(_dbPath, !m_vc.ok()),
 	m_preMine(_us, m_stateDB),
 	m_postMine(_us, m_stateDB),
 	m_workState(Active)
@@ -65,7 +66,14 @@ Client::Client(std::string const& _clientVersion, Address _us, std::string const
 
 	// Synchronise the state according to the head of the block chain.
 	// TODO: currently it contains keys for *all* blocks. Make it remove old ones.
+	m_preMine.setCheckpoints(&m_checkpoints);
+	m_preMine.onSyncProgress([&](SyncProgress const& _p)
+	{
+		m_syncProgress = _p;
+		cnote << "Synced state to block" << _p.current << "of" << _p.to;
+	});
 	m_preMine.sync(m_bc);
+	noteCheckpoint();
 	m_postMine = m_preMine;
 	m_changed = true;
 
@@ -185,11 +193,12 @@ void Client::work()
 		{
 			if (m_doMine)
 				cnote << "New block on chain: Restarting mining operation.";
+			noteCheckpoint();
 			changed = true;
 			m_restartMining = true;	// need to re-commit to mine.
 			m_postMine = m_preMine;
 		}
-		if (m_postMine.sync(m_tq))
+		if (m_postMine.sync(m_tq, c_maxSyncSteps, chrono::steady_clock::now() + chrono::milliseconds(c_maxSyncMilliseconds)))
 		{
 			if (m_doMine)
 				cnote << "Additional transaction ready: Restarting mining operation.";
@@ -198,7 +207,10 @@ void Client::work()
 		}
 	}
 
-	if (m_doMine)
+	// If a transaction's contract code ran out of budget, we get straight back to the network before carrying on with it.
+	bool suspended = m_postMine.isSuspended();
+
+	if (m_doMine && !suspended)
 	{
 		if (m_restartMining)
 		{
@@ -223,12 +235,23 @@ void Client::work()
 			m_changed = true;
 		}
 	}
-	else
+	else if (!suspended)
 		this_thread::sleep_for(chrono::milliseconds(100));
 
 	m_changed = m_changed || changed;
 }
 
+void Client::noteCheckpoint()
+{
+	auto h = m_bc.currentHash();
+	auto n = m_bc.details(h).number;
+	if (m_checkpoints.isDue(n))
+	{
+		m_checkpoints.put(h, n, m_preMine.checkpoint());
+		cnote << "Checkpointed state at block" << n;
+	}
+}
+
 void Client::lock()
 {
 	m_lock.lock();
@@ -28,6 +28,7 @@
 #include "BlockChain.h"
 #include "TransactionQueue.h"
 #include "State.h"
+#include "StateCheckpoints.h"
 #include "Dagger.h"
 #include "PeerNetwork.h"
 
@@ -87,6 +88,10 @@ public:
 	h256 transact(Secret _secret, Address _dest, u256 _amount, u256s _data = u256s());
 	h256 transact(Transaction t, Address _src);
 
+	/// Dry-runs each transaction of @a _batch, with the given sender, on the pending state; see State::simulate().
+	/// Any pending transaction left suspended by the last sync is run to completion first.
+	std::vector<ExecutionResult> simulate(std::vector<std::pair<Transaction, Address>> const& _batch) { ClientGuard g(this); m_postMine.finishSuspended(); return m_postMine.simulate(_batch); }
+
 	/// Requires transactions involving this address be queued for inspection.
 	void setInterest(Address _dest);
 
@@ -96,6 +101,9 @@ public:
 	/// @returns alterations in state of a mined block that we wanted to be notified of. Clears the queue.
 	std::vector<std::pair<Address, AddressState>> minedQueue() { ClientGuard g(this); return m_bc.interestQueue(); }
 
+	/// Turn the block chain's index of transactions by hash on or off; see BlockChain::setTransactionIndex().
+	void setTransactionIndex(bool _on) { ClientGuard g(this); m_bc.setTransactionIndex(_on); }
+
 	// Not yet - probably best as using some sort of signals implementation.
 	/// Calls @a _f when a valid transaction is received that involves @a _dest and once per such transaction.
 //	void onPending(Address _dest, function<void(Transaction)> const& _f);
@@ -156,14 +164,21 @@ public:
 	/// Check the progress of the mining.
 	MineProgress miningProgress() const { return m_mineProgress; }
 
+	/// Check how far the state has got in replaying the blocks it needs to catch up with the chain.
+	SyncProgress syncProgress() const { return m_syncProgress; }
+
 private:
 	void work();
 
+	/// Checkpoint the state as of the head of the chain, if one's due.
+	void noteCheckpoint();
+
 	std::string m_clientVersion;		///< Our end-application client's name/version.
 	VersionChecker m_vc;				///< Dummy object to check & update the protocol version.
 	BlockChain m_bc;					///< Maintains block database.
 	TransactionQueue m_tq;				///< Maintains list of incoming transactions not yet on the block chain.
 	Overlay m_stateDB;					///< Acts as the central point for the state database, so multiple States can share it.
+	StateCheckpoints m_checkpoints;		///< Whole states as of every so many blocks, should the state database not have one needed.
 	State m_preMine;					///< The present state of the client.
 	State m_postMine;					///< The state of the client which we're mining (i.e. it'll have all the rewards added).
 	std::unique_ptr<PeerServer> m_net;	///< Should run in background and send us events when blocks found and allow us to send blocks as required.
@@ -174,9 +189,14 @@ private:
 	std::atomic<ClientWorkState> m_workState;
 	bool m_doMine = false;				///< Are we supposed to be mining?
 	MineProgress m_mineProgress;
+	SyncProgress m_syncProgress;
 	mutable bool m_restartMining = false;
 
 	mutable bool m_changed;
+
+	/// Limits on the contract code run by each work() before it returns to the network; whatever's left is resumed next time.
+	static const uint64_t c_maxSyncSteps = 100000;
+	static const unsigned c_maxSyncMilliseconds = 50;
 };
 
 inline ClientGuard::ClientGuard(Client* _c): m_client(_c)
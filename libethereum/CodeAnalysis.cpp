@@ -0,0 +1,242 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file CodeAnalysis.cpp
+ * @author agent <agent@local>
+ * @date 2014
+ */
+
+#include "CodeAnalysis.h"
+
+#include <mutex>
+#include "CompiledCode.h"
+#include "Instruction.h"
+using namespace std;
+using namespace eth;
+
+CodeAnalysis::CodeAnalysis(CompiledCode const& _code):
+	m_hash(_code.hash())
+{
+	unsigned n = _code.size();
+
+	// The instruction boundaries when read straight through.
+	m_jumpDests.resize(n);
+	for (unsigned pc = 0; pc < n; pc += _code.at(pc) == (u256)Instruction::PUSH ? 2 : 1)
+		m_jumpDests[pc] = true;
+
+	// Explore the code from the start.
+	vector<int> owner(n, -1);
+	deque<unsigned> todo;
+	if (n)
+		todo.push_back(0);
+	while (!todo.empty())
+	{
+		if (m_work > c_maxWork)
+		{
+			// Too convoluted to bother with; assume the worst.
+			m_tooComplex = m_dynamicJumps = true;
+			break;
+		}
+		unsigned pc = todo.front();
+		todo.pop_front();
+		enter(_code, pc, owner, todo);
+	}
+
+	m_reachable.resize(n);
+	for (auto const& i: m_blocks)
+	{
+		m_dynamicJumps = m_dynamicJumps || i.second.dynamicJump;
+		for (unsigned pc = i.second.begin; pc < i.second.end && pc < n; ++pc)
+			if (!m_reachable[pc])
+			{
+				m_reachable[pc] = true;
+				++m_reachableSize;
+			}
+	}
+}
+
+void CodeAnalysis::enter(CompiledCode const& _code, unsigned _pc, vector<int>& io_owner, deque<unsigned>& io_todo)
+{
+	if (m_blocks.count(_pc))
+		return;
+
+	if (io_owner[_pc] >= 0)
+	{
+		// Control can come in part-way through a block; end it here and decode the rest afresh, since whatever the
+		// block pushed before this point can no longer be relied upon.
+		CodeBlock& head = m_blocks[io_owner[_pc]];
+		for (unsigned pc = _pc; pc < head.end && pc < io_owner.size(); ++pc)
+			if (io_owner[pc] == (int)head.begin)
+				io_owner[pc] = -1;
+		head.end = _pc;
+		head.successors = { _pc };
+		head.dynamicJump = false;
+		head.leaves = false;
+	}
+	decode(_code, _pc, io_owner, io_todo);
+}
+
+void CodeAnalysis::decode(CompiledCode const& _code, unsigned _begin, vector<int>& io_owner, deque<unsigned>& io_todo)
+{
+	unsigned n = _code.size();
+	CodeBlock b;
+	b.begin = _begin;
+
+	// The values known to be at the top of the stack; those beneath are unknown.
+	vector<pair<bool, u256>> stack;
+	auto pop = [&]()
+	{
+		pair<bool, u256> ret(false, 0);
+		if (!stack.size())
+			return ret;
+		ret = stack.back();
+		stack.pop_back();
+		return ret;
+	};
+	auto follow = [&](unsigned _pc)
+	{
+		if (_pc >= n)
+			b.leaves = true;
+		else
+		{
+			b.successors.push_back(_pc);
+			io_todo.push_back(_pc);
+		}
+	};
+	auto jump = [&](pair<bool, u256> const& _target)
+	{
+		if (!_target.first)
+			b.dynamicJump = true;
+		else if (_target.second >= n)
+			b.leaves = true;
+		else
+		{
+			if (!m_jumpDests[(unsigned)_target.second])
+				m_jumpsIntoData = true;
+			follow((unsigned)_target.second);
+		}
+	};
+
+	unsigned pc = _begin;
+	for (bool done = false; !done;)
+	{
+		if (pc >= n)
+		{
+			b.leaves = true;
+			break;
+		}
+		if (pc != _begin && io_owner[pc] >= 0)
+		{
+			// Run into another block.
+			follow(pc);
+			break;
+		}
+		io_owner[pc] = _begin;
+		++m_work;
+
+		u256 const& w = _code.at(pc);
+		auto it = w <= 0xff ? c_instructionInfo.find((Instruction)(uint8_t)w) : c_instructionInfo.end();
+		if (it == c_instructionInfo.end())
+		{
+			m_badInstruction = true;
+			++pc;
+			break;
+		}
+
+		switch (it->first)
+		{
+		case Instruction::PUSH:
+			stack.push_back(pc + 1 < n ? make_pair(true, _code.at(pc + 1)) : make_pair(false, u256(0)));
+			pc += 2;
+			continue;
+		case Instruction::DUP:
+		{
+			auto a = pop();
+			stack.push_back(a);
+			stack.push_back(a);
+			break;
+		}
+		case Instruction::SWAP:
+		{
+			auto a = pop();
+			auto c = pop();
+			stack.push_back(a);
+			stack.push_back(c);
+			break;
+		}
+		case Instruction::STOP:
+		case Instruction::SUICIDE:
+			done = true;
+			break;
+		case Instruction::JMP:
+			jump(pop());
+			done = true;
+			break;
+		case Instruction::JMPI:
+		{
+			auto cond = pop();
+			auto target = pop();
+			if (!cond.first || cond.second)
+				jump(target);
+			if (!cond.first || !cond.second)
+				follow(pc + 1);
+			done = true;
+			break;
+		}
+		default:
+			if (it->second.args < 0)
+				stack.clear();
+			else
+				for (int i = 0; i < it->second.args; ++i)
+					pop();
+			for (int i = 0; i < it->second.ret; ++i)
+				stack.push_back(make_pair(false, u256(0)));
+			break;
+		}
+		++pc;
+	}
+
+	b.end = pc;
+	m_blocks[_begin] = b;
+}
+
+shared_ptr<CodeAnalysis const> CodeAnalysis::analyse(CompiledCode const& _code)
+{
+	static mutex s_lock;
+	static map<h256, shared_ptr<CodeAnalysis const>> s_cached;
+	static deque<h256> s_order;	// Oldest first; for eviction.
+
+	{
+		lock_guard<mutex> l(s_lock);
+		auto it = s_cached.find(_code.hash());
+		if (it != s_cached.end())
+			return it->second;
+	}
+
+	shared_ptr<CodeAnalysis const> ret(new CodeAnalysis(_code));
+
+	lock_guard<mutex> l(s_lock);
+	if (s_cached.insert(make_pair(ret->hash(), ret)).second)
+	{
+		s_order.push_back(ret->hash());
+		if (s_order.size() > c_maxCached)
+		{
+			s_cached.erase(s_order.front());
+			s_order.pop_front();
+		}
+	}
+	return ret;
+}
@@ -0,0 +1,119 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file CodeAnalysis.h
+ * @author agent <agent@local>
+ * @date 2014
+ */
+
+#pragma once
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <memory>
+#include "Common.h"
+#include "FixedHash.h"
+
+namespace eth
+{
+
+class CompiledCode;
+
+/// A straight run of instructions, entered only at its start and left only at its end.
+struct CodeBlock
+{
+	unsigned begin = 0;					///< PC of the first instruction.
+	unsigned end = 0;					///< One past the last word of the last instruction (including any PUSH operand).
+	std::vector<unsigned> successors;	///< PCs of the blocks that control may pass to within the analysed code.
+	bool dynamicJump = false;			///< True if it ends with a jump whose target is only known at run time.
+	bool leaves = false;				///< True if control may pass beyond the analysed code.
+};
+
+/**
+ * @brief Static analysis of a contract's code.
+ * Works on the compiled (contiguous from address 0) code: builds the control-flow graph, following jumps whose targets
+ * are pushed as constants within the same block, and from that the code reachable from the start. Code after a
+ * jump whose target is computed at run time is assumed to be able to go anywhere.
+ *
+ * The VM allows jumps to any word, including PUSH operands. Such jumps, and reachable words that aren't instructions,
+ * make a contract pathological: nothing sensible can be precomputed about it.
+ */
+class CodeAnalysis
+{
+public:
+	/// Analyse @a _code.
+	explicit CodeAnalysis(CompiledCode const& _code);
+
+	/// @returns the analysis of @a _code, reusing that of any code recently analysed with the same hash.
+	static std::shared_ptr<CodeAnalysis const> analyse(CompiledCode const& _code);
+
+	/// @returns the hash of the code analysed.
+	h256 const& hash() const { return m_hash; }
+
+	/// @returns the blocks that may be reached from the start of the code, by first PC.
+	std::map<unsigned, CodeBlock> const& blocks() const { return m_blocks; }
+
+	/// @returns true if @a _pc is at an instruction (rather than a PUSH operand) when the code is read straight through.
+	bool isJumpDest(u256 const& _pc) const { return _pc < m_jumpDests.size() && m_jumpDests[(unsigned)_pc]; }
+
+	/// @returns true if the word at @a _pc may be executed (as an instruction or PUSH operand).
+	bool isReachable(u256 const& _pc) const { return _pc < m_reachable.size() && (m_dynamicJumps || m_reachable[(unsigned)_pc]); }
+
+	/// @returns the number of words that may be executed.
+	unsigned reachableSize() const { return m_dynamicJumps ? (unsigned)m_reachable.size() : m_reachableSize; }
+
+	/// @returns true if any reachable block jumps to a computed target.
+	bool hasDynamicJumps() const { return m_dynamicJumps; }
+
+	/// @returns true if a word that isn't an instruction may be executed as one.
+	bool reachesBadInstruction() const { return m_badInstruction; }
+
+	/// @returns true if a constant jump target is a PUSH operand.
+	bool jumpsIntoData() const { return m_jumpsIntoData; }
+
+	/// @returns true if the code was too convoluted to analyse fully, in which case everything is assumed reachable.
+	bool isTooComplex() const { return m_tooComplex; }
+
+	/// @returns true if the code is unfit for any precomputation.
+	bool isPathological() const { return m_badInstruction || m_jumpsIntoData || m_tooComplex; }
+
+	/// The greatest number of analyses remembered by analyse().
+	static const unsigned c_maxCached = 1024;
+
+	/// The greatest number of instructions decoded (counting those decoded again when a block is split) before giving up.
+	static const unsigned c_maxWork = 1 << 20;
+
+private:
+	/// Make a block start at @a _pc, splitting any block that runs through it.
+	void enter(CompiledCode const& _code, unsigned _pc, std::vector<int>& io_owner, std::deque<unsigned>& io_todo);
+
+	/// Decode the block starting at @a _begin; @a io_owner gives, for each word decoded as an instruction, its block.
+	void decode(CompiledCode const& _code, unsigned _begin, std::vector<int>& io_owner, std::deque<unsigned>& io_todo);
+
+	h256 m_hash;
+	std::map<unsigned, CodeBlock> m_blocks;
+	std::vector<bool> m_jumpDests;
+	std::vector<bool> m_reachable;
+	unsigned m_reachableSize = 0;
+	bool m_dynamicJumps = false;
+	bool m_badInstruction = false;
+	bool m_jumpsIntoData = false;
+	bool m_tooComplex = false;
+	unsigned m_work = 0;
+};
+
+}
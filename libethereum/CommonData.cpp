@@ -59,27 +59,67 @@ std::string eth::randomWord()
 	return ret;
 }
 
+char const eth::c_hexDuplets[513] =
+	"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+	"202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+	"404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+	"606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+	"808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+	"a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+	"c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+	"e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+/// The value of each hex digit character, indexed by character; -1 for non-digits.
+static const signed char c_hexValues[256] =
+{
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
 int eth::fromHex(char _i)
 {
-	if (_i >= '0' && _i <= '9')
-		return _i - '0';
-	if (_i >= 'a' && _i <= 'f')
-		return _i - 'a' + 10;
-	if (_i >= 'A' && _i <= 'F')
-		return _i - 'A' + 10;
-	throw BadHexCharacter();
+	int ret = c_hexValues[(byte)_i];
+	if (ret < 0)
+		throw BadHexCharacter();
+	return ret;
+}
+
+bool eth::fromHex(char const* _hex, size_t _size, byte* o_data)
+{
+	// Accumulate the bitwise-or of everything decoded; any invalid digit leaves it negative.
+	int bad = 0;
+	for (char const* e = _hex + 2 * _size; _hex != e; _hex += 2, ++o_data)
+	{
+		int h = c_hexValues[(byte)_hex[0]];
+		int l = c_hexValues[(byte)_hex[1]];
+		bad |= h | l;
+		*o_data = (byte)(h * 16 + l);
+	}
+	return bad >= 0;
 }
 
 bytes eth::fromHex(std::string const& _s)
 {
-	assert(_s.size() % 2 == 0);
-	if (_s.size() < 2)
-		return bytes();
-	uint s = (_s[0] == '0' && _s[1] == 'x') ? 2 : 0;
-	std::vector<uint8_t> ret;
-	ret.reserve((_s.size() - s) / 2);
-	for (uint i = s; i < _s.size(); i += 2)
-		ret.push_back((byte)(fromHex(_s[i]) * 16 + fromHex(_s[i + 1])));
+	uint s = (_s.size() >= 2 && _s[0] == '0' && _s[1] == 'x') ? 2 : 0;
+	if ((_s.size() - s) % 2)
+		throw BadHexCharacter();
+	bytes ret((_s.size() - s) / 2);
+	if (!fromHex(_s.data() + s, ret.size(), ret.data()))
+		throw BadHexCharacter();
 	return ret;
 }
 
@@ -35,15 +35,37 @@ namespace eth
 
 // String conversion functions, mainly to/from hex/nibble/byte representations.
 
+/// The hex duplets of every byte value, in order: "000102...feff".
+extern char const c_hexDuplets[513];
+
+/// Write the hex duplets of the @a _size bytes at @a _data into @a o_hex, which must have room for 2 * @a _size chars.
+inline void toHex(byte const* _data, size_t _size, char* o_hex)
+{
+	for (byte const* e = _data + _size; _data != e; ++_data, o_hex += 2)
+		memcpy(o_hex, c_hexDuplets + 2 * *_data, 2);
+}
+
 /// Convert a series of bytes to the corresponding string of hex duplets.
 /// @param _w specifies the width of each of the elements. Defaults to two - enough to represent a byte.
 /// @example toHex("A\x69") == "4169"
 template <class _T>
 std::string toHex(_T const& _data, int _w = 2)
 {
+	typedef typename std::make_unsigned<typename std::decay<decltype(*std::begin(_data))>::type>::type Element;
+	if (_w == 2 && sizeof(Element) == 1)
+	{
+		std::string ret(_data.size() * 2, 0);
+		char* o = &ret[0];
+		for (Element i: _data)
+		{
+			memcpy(o, c_hexDuplets + 2 * i, 2);
+			o += 2;
+		}
+		return ret;
+	}
 	std::ostringstream ret;
 	for (auto i: _data)
-		ret << std::hex << std::setfill('0') << std::setw(_w) << (int)(typename std::make_unsigned<decltype(i)>::type)i;
+		ret << std::hex << std::setfill('0') << std::setw(_w) << (int)(Element)i;
 	return ret.str();
 }
 
@@ -51,6 +73,10 @@ std::string toHex(_T const& _data, int _w = 2)
 /// @example fromHex('A') == 10 && fromHex('f') == 15 && fromHex('5') == 5
 int fromHex(char _i);
 
+/// Converts the @a _size hex duplets at @a _hex into bytes, written to @a o_data, which must have room for @a _size.
+/// @returns false if any character isn't a hex digit, in which case @a o_data is left partly written.
+bool fromHex(char const* _hex, size_t _size, byte* o_data);
+
 /// Converts a (printable) ASCII hex string into the corresponding byte stream.
 /// @example fromHex("41626261") == asBytes("Abba")
 bytes fromHex(std::string const& _s);
@@ -0,0 +1,72 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file CompiledCode.cpp
+ * @author agent <agent@local>
+ * @date 2014
+ */
+
+#include "CompiledCode.h"
+
+#include <mutex>
+#include "CommonEth.h"
+using namespace std;
+using namespace eth;
+
+CompiledCode::CompiledCode(map<u256, u256> const& _mem)
+{
+	// The code is the contiguous run of words from address 0.
+	u256 next = 0;
+	for (auto const& i: _mem)
+		if (i.first != next || m_code.size() == c_maxSize)
+			break;
+		else
+		{
+			m_code.push_back(i.second);
+			++next;
+		}
+
+	bytes b(m_code.size() * 32);
+	for (unsigned i = 0; i < m_code.size(); ++i)
+	{
+		bytesRef word(b.data() + i * 32, 32);
+		toBigEndian(m_code[i], word);
+	}
+	m_hash = sha3(b);
+}
+
+shared_ptr<CompiledCode const> CompiledCode::compile(map<u256, u256> const& _mem)
+{
+	static mutex s_lock;
+	static map<h256, weak_ptr<CompiledCode const>> s_live;
+
+	shared_ptr<CompiledCode const> ret(new CompiledCode(_mem));
+
+	lock_guard<mutex> l(s_lock);
+	auto it = s_live.find(ret->hash());
+	if (it != s_live.end())
+		if (auto existing = it->second.lock())
+			return existing;
+
+	// Take the opportunity to forget code that's no longer in use.
+	for (auto i = s_live.begin(); i != s_live.end();)
+		if (i->second.expired())
+			i = s_live.erase(i);
+		else
+			++i;
+	s_live[ret->hash()] = ret;
+	return ret;
+}
@@ -0,0 +1,69 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file CompiledCode.h
+ * @author agent <agent@local>
+ * @date 2014
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include "Common.h"
+#include "FixedHash.h"
+
+namespace eth
+{
+
+/**
+ * @brief Contract code prepared ahead of time for the VM.
+ * The interpreter fetches each instruction (and each PUSH operand) from the contract's storage map. A compiled
+ * contract instead holds the contiguous run of words starting at address 0 in a flat array, so that fetches within
+ * it are a bounds check and an index. Code is shared between all contracts with the same code hash.
+ *
+ * The VM falls back to fetching from storage whenever it leaves the compiled range or the contract writes into it.
+ */
+class CompiledCode
+{
+public:
+	/// Compile the code found in the contract memory @a _mem.
+	explicit CompiledCode(std::map<u256, u256> const& _mem);
+
+	/// @returns the compiled code for the contract memory @a _mem, reusing that of any live contract with identical code.
+	static std::shared_ptr<CompiledCode const> compile(std::map<u256, u256> const& _mem);
+
+	/// @returns the number of words compiled.
+	unsigned size() const { return (unsigned)m_code.size(); }
+
+	/// @returns true if the word at @a _pc is within the compiled range.
+	bool covers(u256 const& _pc) const { return _pc < m_code.size(); }
+
+	/// @returns the word at @a _pc. Only valid if covers(_pc).
+	u256 const& at(u256 const& _pc) const { return m_code[(unsigned)_pc]; }
+
+	/// @returns the hash of the code.
+	h256 const& hash() const { return m_hash; }
+
+	/// Longest run of words that will be compiled.
+	static const unsigned c_maxSize = 65536;
+
+private:
+	u256s m_code;
+	h256 m_hash;
+};
+
+}
@@ -0,0 +1,132 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file ECCrypto.cpp
+ * @author agent <agent@local>
+ * @date 2014
+ */
+
+#include "ECCrypto.h"
+
+#include <secp256k1.h>
+using namespace std;
+using namespace eth;
+
+/// Serialise @a _p as an uncompressed public key for libsecp256k1.
+static array<byte, 65> toPubkey(Public const& _p)
+{
+	array<byte, 65> ret;
+	ret[0] = 4;
+	memcpy(ret.data() + 1, _p.data(), 64);
+	return ret;
+}
+
+ECCrypto& ECCrypto::get()
+{
+	static ECCrypto s_ret;
+	return s_ret;
+}
+
+ECCrypto::ECCrypto():
+	m_generator(fromHex("79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798483ada7726a3c4655da4fbfc0e1108a8fd17b448a68554199c47d08ffb10d4b8"))
+{
+	secp256k1_start();
+}
+
+bool ECCrypto::valid(Public const& _p) const
+{
+	auto pub = toPubkey(_p);
+	return secp256k1_ecdsa_pubkey_verify(pub.data(), (int)pub.size());
+}
+
+bool ECCrypto::mul(Public& io_p, h256 const& _k) const
+{
+	auto pub = toPubkey(io_p);
+	if (!secp256k1_ecdsa_pubkey_verify(pub.data(), (int)pub.size()))		// TODO: Check both are less than P.
+		return false;
+
+	if (io_p == m_generator)
+	{
+		// Fast path: the generator has precomputed multiples.
+		if (secp256k1_ecdsa_seckey_verify(_k.data()))
+		{
+			int pubLen = (int)pub.size();
+			secp256k1_ecdsa_pubkey_create(pub.data(), &pubLen, _k.data(), 0);
+		}
+	}
+	else
+		secp256k1_ecdsa_pubkey_tweak_mul(pub.data(), (int)pub.size(), _k.data());
+
+	memcpy(io_p.data(), pub.data() + 1, 64);
+	return true;
+}
+
+bool ECCrypto::add(Public& io_p, Public const& _q) const
+{
+	auto pub = toPubkey(io_p);
+	auto tweak = toPubkey(_q);
+	if (!secp256k1_ecdsa_pubkey_verify(pub.data(), (int)pub.size()) || !secp256k1_ecdsa_pubkey_verify(tweak.data(), (int)tweak.size()))
+		return false;
+
+	// NOTE: libsecp256k1 only offers a scalar tweak, given by the first 32 bytes of the serialised point.
+	secp256k1_ecdsa_pubkey_tweak_add(pub.data(), (int)pub.size(), tweak.data());
+	memcpy(io_p.data(), pub.data() + 1, 64);
+	return true;
+}
+
+bool ECCrypto::recover(h256 const& _msg, u256 const& _v, h256 const& _r, h256 const& _s, Public& o_p)
+{
+	RecoveryKey key(_msg, _r, _s, _v);
+	{
+		lock_guard<mutex> l(m_lock);
+		auto it = m_recovered.find(key);
+		if (it != m_recovered.end())
+		{
+			++m_hits;
+			o_p = it->second.second;
+			return it->second.first;
+		}
+		++m_misses;
+	}
+
+	bool ret = false;
+	o_p = Public();
+	if (_v >= 27 && _v <= 30)
+	{
+		array<byte, 64> sig;
+		memcpy(sig.data(), _r.data(), 32);
+		memcpy(sig.data() + 32, _s.data(), 32);
+		byte pubkey[65];
+		int pubkeylen = 65;
+		if (secp256k1_ecdsa_recover_compact(_msg.data(), 32, sig.data(), pubkey, &pubkeylen, 0, (int)_v - 27))
+		{
+			memcpy(o_p.data(), pubkey + 1, 64);
+			ret = true;
+		}
+	}
+
+	lock_guard<mutex> l(m_lock);
+	if (m_recovered.insert(make_pair(key, make_pair(ret, o_p))).second)
+	{
+		m_recoveredOrder.push_back(key);
+		if (m_recoveredOrder.size() > c_maxRecovered)
+		{
+			m_recovered.erase(m_recoveredOrder.front());
+			m_recoveredOrder.pop_front();
+		}
+	}
+	return ret;
+}
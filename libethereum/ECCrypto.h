@@ -0,0 +1,83 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file ECCrypto.h
+ * @author agent <agent@local>
+ * @date 2014
+ */
+
+#pragma once
+
+#include <map>
+#include <deque>
+#include <tuple>
+#include <mutex>
+#include "CommonEth.h"
+
+namespace eth
+{
+
+/**
+ * @brief The secp256k1 operations behind the VM's elliptic-curve instructions.
+ * Points are passed as the concatenation of their big-endian affine coordinates (x then y).
+ *
+ * Multiplication of the generator goes through libsecp256k1's precomputed generator tables rather than the generic
+ * point multiplication, and public-key recoveries are remembered in a bounded cache keyed by message and signature.
+ */
+class ECCrypto
+{
+public:
+	/// The process-wide instance.
+	static ECCrypto& get();
+
+	/// @returns true if @a _p is a point on the curve.
+	bool valid(Public const& _p) const;
+
+	/// Multiply @a io_p by @a _k. @a io_p is left unchanged if @a _k is zero or not less than the curve order.
+	/// @returns false (and leaves @a io_p unchanged) if @a io_p is not a point on the curve.
+	bool mul(Public& io_p, h256 const& _k) const;
+
+	/// Tweak @a io_p by the point @a _q as the ECADD instruction specifies.
+	/// @returns false (and leaves @a io_p unchanged) if either isn't a point on the curve.
+	bool add(Public& io_p, Public const& _q) const;
+
+	/// Recover the public key that signed @a _msg giving the signature (@a _v, @a _r, @a _s).
+	/// @returns false if no key can be recovered, in which case @a o_p is zeroed.
+	bool recover(h256 const& _msg, u256 const& _v, h256 const& _r, h256 const& _s, Public& o_p);
+
+	/// Number of recoveries answered from the cache.
+	uint64_t recoverHits() const { return m_hits; }
+	/// Number of recoveries that had to be calculated.
+	uint64_t recoverMisses() const { return m_misses; }
+
+	/// The greatest number of recoveries remembered.
+	static const unsigned c_maxRecovered = 4096;
+
+private:
+	ECCrypto();
+
+	using RecoveryKey = std::tuple<h256, h256, h256, u256>;
+
+	Public m_generator;
+
+	std::mutex m_lock;
+	std::map<RecoveryKey, std::pair<bool, Public>> m_recovered;
+	std::deque<RecoveryKey> m_recoveredOrder;	///< Oldest first; for eviction.
+	uint64_t m_hits = 0;
+	uint64_t m_misses = 0;
+};
+
+}
@@ -23,13 +23,13 @@ class BadCast: public RLPException {};
 class BadRLP: public RLPException {};
 
 class VMException: public Exception {};
-class StepsDone: public VMException {};
 class BreakPointHit: public VMException {};
 class BadInstruction: public VMException {};
 class StackTooSmall: public VMException { public: StackTooSmall(u256 _req, u256 _got): req(_req), got(_got) {} u256 req; u256 got; };
 class OperandOutOfRange: public VMException { public: OperandOutOfRange(u256 _min, u256 _max, u256 _got): mn(_min), mx(_max), got(_got) {} u256 mn; u256 mx; u256 got; };
 
 class NoSuchContract: public Exception {};
+class SuspendedState: public Exception {};
 class ContractAddressCollision: public Exception {};
 class FeeTooSmall: public Exception {};
 class InvalidSignature: public Exception {};
@@ -62,6 +62,7 @@ public:
 	u256 extro(Address _a, u256 _pos) { return 0; }
 	u256 extroPrice(Address _a) { return 0; }
 	void suicide(Address _a) {}
+	unsigned codeStores() const { return 0; }
 
 	Address myAddress;
 	Address txSender;
@@ -150,14 +150,21 @@ template<> inline size_t FixedHash<32>::hash::operator()(FixedHash<32> const& va
 	return (size_t)hash;
 }
 
-/// Stream I/O for the FixedHash class.
+/// Stream I/O for the FixedHash class. Honours the stream's width, fill and left/right adjustment as a string would.
 template <unsigned N>
 inline std::ostream& operator<<(std::ostream& _out, FixedHash<N> const& _h)
 {
-	_out << std::noshowbase << std::hex << std::setfill('0');
-	for (unsigned i = 0; i < N; ++i)
-		_out << std::setw(2) << (int)_h[i];
-	_out << std::dec;
+	char hex[N * 2];
+	toHex(_h.data(), N, hex);
+	std::streamsize pad = std::max<std::streamsize>(_out.width() - N * 2, 0);
+	bool left = (_out.flags() & std::ios_base::adjustfield) == std::ios_base::left;
+	_out.width(0);
+	if (!left)
+		for (; pad; --pad)
+			_out.put(_out.fill());
+	_out.write(hex, N * 2);
+	for (; pad; --pad)
+		_out.put(_out.fill());
 	return _out;
 }
 
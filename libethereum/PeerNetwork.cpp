@@ -60,3 +60,46 @@ std::string eth::reasonOf(DisconnectReason _r)
 	}
 }
 
+bytesRef PacketBuffer::writable()
+{
+	if (m_begin == m_end)
+		m_begin = m_end = 0;
+
+	// Enough space for the rest of the packet underway (or, if its header isn't in yet, the header), up to a limit.
+	size_t have = m_end - m_begin;
+	size_t need = max<size_t>(m_packet, 8);
+	size_t want = have < need ? min<size_t>(need - have, c_readSize) : 1;
+	if (m_buffer.size() - m_end < want)
+	{
+		if (m_begin)
+		{
+			memmove(m_buffer.data(), m_buffer.data() + m_begin, have);
+			m_begin = 0;
+			m_end = have;
+		}
+		if (m_buffer.size() - m_end < want)
+			m_buffer.resize(max(m_buffer.size() * 2, m_end + want));
+	}
+	return bytesRef(m_buffer.data() + m_end, m_buffer.size() - m_end);
+}
+
+PacketBuffer::Result PacketBuffer::next(bytesConstRef& o_payload)
+{
+	size_t have = m_end - m_begin;
+	byte const* p = m_buffer.data() + m_begin;
+	if (!m_packet)
+	{
+		if (have < 8)
+			return NeedMore;
+		if (p[0] != 0x22 || p[1] != 0x40 || p[2] != 0x08 || p[3] != 0x91)
+			return OutOfAlignment;
+		m_packet = 8 + (((size_t)p[4] << 24) | (p[5] << 16) | (p[6] << 8) | p[7]);
+	}
+	if (have < m_packet)
+		return NeedMore;
+
+	o_payload = bytesConstRef(p + 8, m_packet - 8);
+	m_begin += m_packet;
+	m_packet = 0;
+	return Ready;
+}
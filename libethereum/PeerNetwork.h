@@ -90,6 +90,44 @@ struct PeerInfo
 	std::chrono::steady_clock::duration lastPing;
 };
 
+/**
+ * @brief Splits the stream of bytes from a peer into packets, in place.
+ * Reads from the socket go straight into the buffer, and each complete packet is given out as a view into it. Consuming
+ * a packet merely moves past it, so nothing is shifted as packets are taken; the only copying is of a partly received
+ * packet from the end of the buffer back to the start, and then only when it wouldn't otherwise fit.
+ */
+class PacketBuffer
+{
+public:
+	enum Result
+	{
+		NeedMore,		///< No complete packet yet; read some more.
+		Ready,			///< A packet has been given.
+		OutOfAlignment	///< The data doesn't start with the packet magic.
+	};
+
+	/// Most space to make available for a single read.
+	static const unsigned c_readSize = 65536;
+
+	PacketBuffer(): m_buffer(c_readSize) {}
+
+	/// @returns the space into which the next read should go. Invalidates any packets previously given.
+	bytesRef writable();
+
+	/// Note that @a _n bytes were read into the space given by writable().
+	void written(size_t _n) { m_end += _n; }
+
+	/// Extract the next whole packet, if there is one, setting @a o_payload to its (RLP) payload.
+	/// @a o_payload remains valid until the next call to writable().
+	Result next(bytesConstRef& o_payload);
+
+private:
+	bytes m_buffer;
+	size_t m_begin = 0;		///< Start of the data not yet given out as packets.
+	size_t m_end = 0;		///< End of the data read.
+	size_t m_packet = 0;	///< Total size of the packet at m_begin, if its header has been seen; zero otherwise.
+};
+
 class UPnP;
 
 enum class NodeMode
@@ -356,21 +356,25 @@ bool PeerServer::sync(BlockChain& _bc, TransactionQueue& _tq, Overlay& _o)
 		for (auto j: m_peers)
 			if (auto p = j.second.lock())
 			{
-				bytes b;
-				uint n = 0;
+				vector<bytes const*> toSend;
+				uint size = rlpSize(TransactionsPacket);
 				for (auto const& i: _tq.transactions())
 					if ((!m_transactionsSent.count(i.first) && !p->m_knownTransactions.count(i.first)) || p->m_requireTransactions || resendAll)
 					{
-						b += i.second;
-						++n;
+						toSend.push_back(&i.second);
+						size += i.second.size();
 						m_transactionsSent.insert(i.first);
 					}
-				if (n)
+				if (toSend.size())
 				{
 					RLPStream ts;
+					ts.reserve(8 + rlpItemSize(size));
 					PeerSession::prep(ts);
-					ts.appendList(n + 1) << TransactionsPacket;
-					ts.appendRaw(b, n).swapOut(b);
+					ts.appendList(toSend.size() + 1) << TransactionsPacket;
+					for (auto i: toSend)
+						ts.appendRaw(*i);
+					bytes b;
+					ts.swapOut(b);
 					seal(b);
 					p->send(&b);
 				}
@@ -382,11 +386,13 @@ bool PeerServer::sync(BlockChain& _bc, TransactionQueue& _tq, Overlay& _o)
 		if (h != m_latestBlockSent)
 		{
 			// TODO: find where they diverge and send complete new branch.
+			auto block = _bc.block(_bc.currentHash());
 			RLPStream ts;
+			ts.reserve(8 + rlpItemSize(rlpSize(BlocksPacket) + block.size()));
 			PeerSession::prep(ts);
 			ts.appendList(2) << BlocksPacket;
 			bytes b;
-			ts.appendRaw(_bc.block(_bc.currentHash())).swapOut(b);
+			ts.appendRaw(block).swapOut(b);
 			seal(b);
 			for (auto j: m_peers)
 				if (auto p = j.second.lock())
@@ -402,31 +408,19 @@ bool PeerServer::sync(BlockChain& _bc, TransactionQueue& _tq, Overlay& _o)
 		{
 			accepted = 0;
 
-			if (m_incomingBlocks.size())
-				for (auto it = prev(m_incomingBlocks.end());; --it)
+			// They come latest first, so import them the other way round. Any that are bad are forgotten.
+			vector<bytes> blocks(make_move_iterator(m_incomingBlocks.rbegin()), make_move_iterator(m_incomingBlocks.rend()));
+			m_incomingBlocks.clear();
+			auto results = _bc.import(blocks, _o);
+			for (unsigned i = 0; i < blocks.size(); ++i)
+				if (results[i] == ImportResult::Imported)
 				{
-					try
-					{
-						_bc.import(*it, _o);
-						it = m_incomingBlocks.erase(it);
-						++accepted;
-						ret = true;
-					}
-					catch (UnknownParent)
-					{
-						// Don't (yet) know its parent. Leave it for later.
-						m_unknownParentBlocks.push_back(*it);
-						it = m_incomingBlocks.erase(it);
-					}
-					catch (...)
-					{
-						// Some other error - erase it.
-						it = m_incomingBlocks.erase(it);
-					}
-
-					if (it == m_incomingBlocks.begin())
-						break;
+					++accepted;
+					ret = true;
 				}
+				else if (results[i] == ImportResult::UnknownParent)
+					// Don't (yet) know its parent. Leave it for later.
+					m_unknownParentBlocks.push_back(move(blocks[i]));
 			if (!n && accepted)
 			{
 				for (auto i: m_unknownParentBlocks)
@@ -65,19 +65,20 @@ bi::tcp::endpoint PeerSession::endpoint() const
 
 // TODO: BUG! 256 -> work out why things start to break with big packet sizes -> g.t. ~370 blocks.
 
-bool PeerSession::interpret(RLP const& _r)
+bool PeerSession::interpret(RLPValidator const& _packet)
 {
-	clogS(NetRight) << _r;
-	switch (_r[0].toInt<unsigned>())
+	clogS(NetRight) << _packet.root();
+	RLPListView items(_packet);
+	switch (items[0].toInt<unsigned>())
 	{
 	case HelloPacket:
 	{
-		m_protocolVersion = _r[1].toInt<uint>();
-		m_networkId = _r[2].toInt<uint>();
-		auto clientVersion = _r[3].toString();
-		m_caps = _r[4].toInt<uint>();
-		m_listenPort = _r[5].toInt<unsigned short>();
-		m_id = _r[6].toHash<h512>();
+		m_protocolVersion = items[1].toInt<uint>();
+		m_networkId = items[2].toInt<uint>();
+		auto clientVersion = items[3].toString();
+		m_caps = items[4].toInt<uint>();
+		m_listenPort = items[5].toInt<unsigned short>();
+		m_id = items[6].toHash<h512>();
 
 		clogS(NetMessageSummary) << "Hello: " << clientVersion << "V[" << m_protocolVersion << "/" << m_networkId << "]" << m_id.abridged() << showbase << hex << m_caps << dec << m_listenPort;
 
@@ -132,8 +133,8 @@ bool PeerSession::interpret(RLP const& _r)
 	case DisconnectPacket:
 	{
 		string reason = "Unspecified";
-		if (_r[1].isInt())
-			reason = reasonOf((DisconnectReason)_r[1].toInt<int>());
+		if (items[1].isInt())
+			reason = reasonOf((DisconnectReason)items[1].toInt<int>());
 
 		clogS(NetMessageSummary) << "Disconnect (reason: " << reason << ")";
 		if (m_socket.is_open())
@@ -170,12 +171,12 @@ bool PeerSession::interpret(RLP const& _r)
 		break;
 	}
 	case PeersPacket:
-		clogS(NetMessageSummary) << "Peers (" << dec << (_r.itemCount() - 1) << " entries)";
-		for (unsigned i = 1; i < _r.itemCount(); ++i)
+		clogS(NetMessageSummary) << "Peers (" << dec << (items.size() - 1) << " entries)";
+		for (unsigned i = 1; i < items.size(); ++i)
 		{
-			bi::address_v4 peerAddress(_r[i][0].toArray<byte, 4>());
-			auto ep = bi::tcp::endpoint(peerAddress, _r[i][1].toInt<short>());
-			Public id = _r[i][2].toHash<Public>();
+			bi::address_v4 peerAddress(items[i][0].toArray<byte, 4>());
+			auto ep = bi::tcp::endpoint(peerAddress, items[i][1].toInt<short>());
+			Public id = items[i][2].toHash<Public>();
 			if (isPrivateAddress(peerAddress))
 				goto CONTINUE;
 
@@ -210,36 +211,36 @@ bool PeerSession::interpret(RLP const& _r)
 	case TransactionsPacket:
 		if (m_server->m_mode == NodeMode::PeerServer)
 			break;
-		clogS(NetMessageSummary) << "Transactions (" << dec << (_r.itemCount() - 1) << " entries)";
-		m_rating += _r.itemCount() - 1;
-		for (unsigned i = 1; i < _r.itemCount(); ++i)
+		clogS(NetMessageSummary) << "Transactions (" << dec << (items.size() - 1) << " entries)";
+		m_rating += items.size() - 1;
+		for (unsigned i = 1; i < items.size(); ++i)
 		{
-			m_server->m_incomingTransactions.push_back(_r[i].data().toBytes());
-			m_knownTransactions.insert(sha3(_r[i].data()));
+			m_server->m_incomingTransactions.push_back(items[i].data().toBytes());
+			m_knownTransactions.insert(sha3(items[i].data()));
 		}
 		break;
 	case BlocksPacket:
 	{
 		if (m_server->m_mode == NodeMode::PeerServer)
 			break;
-		clogS(NetMessageSummary) << "Blocks (" << dec << (_r.itemCount() - 1) << " entries)";
+		clogS(NetMessageSummary) << "Blocks (" << dec << (items.size() - 1) << " entries)";
 		unsigned used = 0;
-		for (unsigned i = 1; i < _r.itemCount(); ++i)
+		for (unsigned i = 1; i < items.size(); ++i)
 		{
-			auto h = sha3(_r[i].data());
+			auto h = sha3(items[i].data());
 			if (!m_server->m_chain->details(h))
 			{
-				m_server->m_incomingBlocks.push_back(_r[i].data().toBytes());
+				m_server->m_incomingBlocks.push_back(items[i].data().toBytes());
 				m_knownBlocks.insert(h);
 				used++;
 			}
 		}
 		m_rating += used;
 		if (g_logVerbosity >= 3)
-			for (unsigned i = 1; i < _r.itemCount(); ++i)
+			for (unsigned i = 1; i < items.size(); ++i)
 			{
-				auto h = sha3(_r[i].data());
-				BlockInfo bi(_r[i].data());
+				auto h = sha3(items[i].data());
+				BlockInfo bi(items[i].data());
 				if (!m_server->m_chain->details(bi.parentHash) && !m_knownBlocks.count(bi.parentHash))
 					clogS(NetMessageDetail) << "Unknown parent " << bi.parentHash << " of block " << h;
 				else
@@ -250,7 +251,7 @@ bool PeerSession::interpret(RLP const& _r)
 			RLPStream s;
 			prep(s).appendList(3);
 			s << GetChainPacket;
-			s << sha3(_r[1].data());
+			s << sha3(items[1].data());
 			s << c_maxBlocksAsk;
 			sealAndSend(s);
 		}
@@ -260,76 +261,45 @@ bool PeerSession::interpret(RLP const& _r)
 	{
 		if (m_server->m_mode == NodeMode::PeerServer)
 			break;
-		clogS(NetMessageSummary) << "GetChain (" << (_r.itemCount() - 2) << " hashes, " << (_r[_r.itemCount() - 1].toInt<bigint>()) << ")";
-		// ********************************************************************
-		// NEEDS FULL REWRITE!
+		clogS(NetMessageSummary) << "GetChain (" << (items.size() - 2) << " hashes, " << (items[items.size() - 1].toInt<bigint>()) << ")";
 		h256s parents;
-		parents.reserve(_r.itemCount() - 2);
-		for (unsigned i = 1; i < _r.itemCount() - 1; ++i)
-			parents.push_back(_r[i].toHash<h256>());
-		if (_r.itemCount() == 2)
+		parents.reserve(items.size() - 2);
+		for (unsigned i = 1; i < items.size() - 1; ++i)
+			parents.push_back(items[i].toHash<h256>());
+		if (items.size() == 2)
 			break;
 		// return 2048 block max.
-		uint baseCount = (uint)min<bigint>(_r[_r.itemCount() - 1].toInt<bigint>(), c_maxBlocks);
+		uint baseCount = (uint)min<bigint>(items[items.size() - 1].toInt<bigint>(), c_maxBlocks);
 		clogS(NetMessageSummary) << "GetChain (" << baseCount << " max, from " << parents.front() << " to " << parents.back() << ")";
+		BlockChain const& bc = *m_server->m_chain;
+		uint latestNumber = bc.details().number;
 		for (auto parent: parents)
 		{
-			auto h = m_server->m_chain->currentHash();
-			h256 latest = m_server->m_chain->currentHash();
-			uint latestNumber = 0;
-			uint parentNumber = 0;
 			RLPStream s;
-
-			if (m_server->m_chain->details(parent))
+			auto const& pd = bc.details(parent);
+			if (pd && bc.hashFromNumber(pd.number) == parent)
 			{
-				latestNumber = m_server->m_chain->details(latest).number;
-				parentNumber = m_server->m_chain->details(parent).number;
-				uint count = min<uint>(latestNumber - parentNumber, baseCount);
-				clogS(NetAllDetail) << "Requires " << dec << (latestNumber - parentNumber) << " blocks from " << latestNumber << " to " << parentNumber;
-				clogS(NetAllDetail) << latest << " - " << parent;
-
+				// On our longest chain: send the blocks that follow it, latest first.
+				h256s hashes = bc.hashesFromNumbers(pd.number + 1, min<uint>(latestNumber - pd.number, baseCount));
+				clogS(NetAllDetail) << "Sending " << dec << hashes.size() << " blocks from " << (pd.number + hashes.size()) << " to " << pd.number;
 				prep(s);
-				s.appendList(1 + count) << BlocksPacket;
-				uint endNumber = m_server->m_chain->details(parent).number;
-				uint startNumber = endNumber + count;
-				clogS(NetAllDetail) << "Sending " << dec << count << " blocks from " << startNumber << " to " << endNumber;
-
-				uint n = latestNumber;
-				for (; n > startNumber; n--, h = m_server->m_chain->details(h).parent) {}
-				for (uint i = 0; i < count; ++i, --n, h = m_server->m_chain->details(h).parent)
-				{
-					if (h == parent || n == endNumber)
-					{
-						cwarn << "BUG! Couldn't create the reply for GetChain!";
-						return true;
-					}
-					clogS(NetAllDetail) << "   " << dec << i << " " << h;
-					s.appendRaw(m_server->m_chain->block(h));
-				}
-				clogS(NetAllDetail) << "Parent: " << h;
+				s.appendList(1 + hashes.size()) << BlocksPacket;
+				for (auto h = hashes.rbegin(); h != hashes.rend(); ++h)
+					s.appendRaw(bc.block(*h));
 			}
 			else if (parent != parents.back())
+				// still some parents left - try them.
 				continue;
-
-			if (h != parent)
+			else
 			{
-				// not in the blockchain;
-				if (parent == parents.back())
-				{
-					// out of parents...
-					clogS(NetAllDetail) << "GetChain failed; not in chain";
-					// No good - must have been on a different branch.
-					s.clear();
-					prep(s).appendList(2) << NotInChainPacket << parents.back();
-				}
-				else
-					// still some parents left - try them.
-					continue;
+				// out of parents...
+				clogS(NetAllDetail) << "GetChain failed; not in chain";
+				// No good - must have been on a different branch.
+				prep(s).appendList(2) << NotInChainPacket << parents.back();
 			}
 			// send the packet (either Blocks or NotInChain) & exit.
 			sealAndSend(s);
 			break;
-			// ********************************************************************
 		}
 		break;
 	}
@@ -337,7 +307,7 @@ bool PeerSession::interpret(RLP const& _r)
 	{
 		if (m_server->m_mode == NodeMode::PeerServer)
 			break;
-		h256 noGood = _r[1].toHash<h256>();
+		h256 noGood = items[1].toHash<h256>();
 		clogS(NetMessageSummary) << "NotInChain (" << noGood << ")";
 		if (noGood == m_server->m_chain->genesisHash())
 		{
@@ -413,10 +383,7 @@ bool PeerSession::checkPacket(bytesConstRef _msg)
 	uint32_t len = ((_msg[4] * 256 + _msg[5]) * 256 + _msg[6]) * 256 + _msg[7];
 	if (_msg.size() != len + 8)
 		return false;
-	RLP r(_msg.cropped(8));
-	if (r.actualSize() != len)
-		return false;
-	return true;
+	return RLPValidator(_msg.cropped(8)).isValid();
 }
 
 void PeerSession::sendDestroy(bytes& _msg)
@@ -515,7 +482,8 @@ void PeerSession::start()
 void PeerSession::doRead()
 {
 	auto self(shared_from_this());
-	m_socket.async_read_some(boost::asio::buffer(m_data), [this,self](boost::system::error_code ec, std::size_t length)
+	auto space = m_incoming.writable();
+	m_socket.async_read_some(boost::asio::buffer(space.data(), space.size()), [this,self](boost::system::error_code ec, std::size_t length)
 	{
 		if (ec)
 		{
@@ -526,48 +494,33 @@ void PeerSession::doRead()
 		{
 			try
 			{
-				m_incoming.resize(m_incoming.size() + length);
-				memcpy(m_incoming.data() + m_incoming.size() - length, m_data.data(), length);
-				while (m_incoming.size() > 8)
+				m_incoming.written(length);
+				bytesConstRef payload;
+				for (PacketBuffer::Result r; (r = m_incoming.next(payload)) != PacketBuffer::NeedMore;)
 				{
-					if (m_incoming[0] != 0x22 || m_incoming[1] != 0x40 || m_incoming[2] != 0x08 || m_incoming[3] != 0x91)
+					if (r == PacketBuffer::OutOfAlignment)
 					{
 						clogS(NetWarn) << "Out of alignment.";
 						disconnect(BadProtocol);
 						return;
-						clogS(NetNote) << "Skipping: " << hex << showbase << (int)m_incoming[0] << dec;
-						memmove(m_incoming.data(), m_incoming.data() + 1, m_incoming.size() - 1);
-						m_incoming.resize(m_incoming.size() - 1);
 					}
-					else
+
+					// enough has come in.
+//					cerr << "Received " << payload.size() << ": " << toHex(payload) << endl;
+					// the frame is already known good; all that's left is to vet the payload, once and for all.
+					RLPValidator packet(payload);
+					if (!packet.isValid())
 					{
-						uint32_t len = fromBigEndian<uint32_t>(bytesConstRef(m_incoming.data() + 4, 4));
-						uint32_t tlen = len + 8;
-						if (m_incoming.size() < tlen)
-							break;
-
-						// enough has come in.
-//						cerr << "Received " << len << ": " << toHex(bytesConstRef(m_incoming.data() + 8, len)) << endl;
-						auto data = bytesConstRef(m_incoming.data(), tlen);
-						if (!checkPacket(data))
-						{
-							cerr << "Received " << len << ": " << toHex(bytesConstRef(m_incoming.data() + 8, len)) << endl;
-							cwarn << "INVALID MESSAGE RECEIVED";
-							disconnect(BadProtocol);
-							return;
-						}
-						else
-						{
-							RLP r(data.cropped(8));
-							if (!interpret(r))
-							{
-								// error
-								dropped();
-								return;
-							}
-						}
-						memmove(m_incoming.data(), m_incoming.data() + tlen, m_incoming.size() - tlen);
-						m_incoming.resize(m_incoming.size() - tlen);
+						cerr << "Received " << payload.size() << ": " << toHex(payload) << endl;
+						cwarn << "INVALID MESSAGE RECEIVED (" << packet.result() << " at byte " << packet.errorOffset() << ")";
+						disconnect(BadProtocol);
+						return;
+					}
+					else if (!interpret(packet))
+					{
+						// error
+						dropped();
+						return;
 					}
 				}
 				doRead();
@@ -53,7 +53,7 @@ private:
 	void dropped();
 	void doRead();
 	void doWrite(std::size_t length);
-	bool interpret(RLP const& _r);
+	bool interpret(RLPValidator const& _packet);
 
 	/// @returns true iff the _msg forms a valid message for sending or receiving on the network.
 	static bool checkPacket(bytesConstRef _msg);
@@ -65,11 +65,10 @@ private:
 	PeerServer* m_server;
 
 	bi::tcp::socket m_socket;
-	std::array<byte, 65536> m_data;
 	PeerInfo m_info;
 	Public m_id;
 
-	bytes m_incoming;
+	PacketBuffer m_incoming;
 	uint m_protocolVersion;
 	uint m_networkId;
 	uint m_reqNetworkId;
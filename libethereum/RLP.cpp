@@ -20,6 +20,8 @@
  */
 
 #include "RLP.h"
+
+#include <algorithm>
 using namespace std;
 using namespace eth;
 
@@ -71,6 +73,113 @@ RLP RLP::operator[](uint _i) const
 	return RLP(m_lastItem);
 }
 
+RLPListView::RLPListView(RLP const& _list)
+{
+	m_inline[0] = 0;
+	if (!_list.isList())
+		return;
+	m_payload = _list.payload().cropped(0, _list.length());
+
+	// A malformed last item is cut short at the end of the payload.
+	uint s = m_payload.size();
+	for (uint o = 0; o < s;)
+	{
+		uint n = RLP(m_payload.cropped(o, s - o)).actualSize();
+		o = n && n <= s - o ? o + n : s;
+		noteEnd(o);
+	}
+}
+
+RLPListView::RLPListView(RLPValidator const& _tree, uint _item)
+{
+	m_inline[0] = 0;
+	if (!_tree.isValid() || !_tree.items()[_item].isList)
+		return;
+	auto const& items = _tree.items();
+	auto const& l = items[_item];
+	m_payload = _tree.data().cropped(l.payload, l.end - l.payload);
+	for (uint i = _item + 1; i < l.next; i = items[i].next)
+		noteEnd(items[i].end - l.payload);
+}
+
+RLPValidator::RLPValidator(bytesConstRef _data, unsigned _maxDepth):
+	m_data(_data)
+{
+	validate(_maxDepth);
+}
+
+void RLPValidator::validate(unsigned _maxDepth)
+{
+	uint s = m_data.size();
+	if (!s)
+		return fail(Empty, 0);
+	if (s > ~(uint32_t)0)
+		return fail(TooLarge, 0);
+
+	// Indices of the lists we're within, innermost last.
+	std::vector<uint32_t> open;
+	for (uint p = 0;;)
+	{
+		for (; !open.empty() && p == m_items[open.back()].end; open.pop_back())
+			m_items[open.back()].next = (uint32_t)m_items.size();
+		if (open.empty() && !m_items.empty())
+			break;
+
+		uint limit = open.empty() ? s : m_items[open.back()].end;
+		byte n = m_data[p];
+		bool isList = n >= c_rlpListStart;
+		uint payload = p + 1;
+		uint len;
+		if (n < c_rlpDataImmLenStart)
+		{
+			payload = p;
+			len = 1;
+		}
+		else if (n <= c_rlpDataIndLenZero || (isList && n <= c_rlpListIndLenZero))
+			len = n - (isList ? c_rlpListStart : c_rlpDataImmLenStart);
+		else
+		{
+			uint lengthSize = n - (isList ? c_rlpListIndLenZero : c_rlpDataIndLenZero);
+			if (lengthSize > limit - payload)
+				return fail(Truncated, p);
+			if (!m_data[payload])
+				return fail(NonCanonical, p);
+			len = 0;
+			for (uint i = 0; i < lengthSize; ++i)
+				len = (len << 8) | m_data[payload + i];
+			payload += lengthSize;
+			if (len < (isList ? c_rlpListImmLenCount : c_rlpDataImmLenCount))
+				return fail(NonCanonical, p);
+		}
+		if (len > limit - payload)
+			return fail(Truncated, p);
+		if (n == c_rlpDataImmLenStart + 1 && m_data[payload] < c_rlpDataImmLenStart)
+			return fail(NonCanonical, p);
+
+		uint32_t index = (uint32_t)m_items.size();
+		m_items.push_back(Item{(uint32_t)p, (uint32_t)payload, (uint32_t)(payload + len), index + 1, isList});
+		if (isList)
+		{
+			if (open.size() >= _maxDepth)
+				return fail(TooDeep, p);
+			open.push_back(index);
+			p = payload;
+		}
+		else
+			p = payload + len;
+	}
+
+	if (m_items[0].end != s)
+		fail(TrailingData, m_items[0].end);
+}
+
+void RLPValidator::fail(Result _r, uint _offset)
+{
+	m_result = _r;
+	m_errorOffset = _offset;
+	m_items.clear();
+}
+
 RLPs RLP::toList() const
 {
 	RLPs ret;
@@ -176,40 +285,64 @@ void RLPStream::noteAppended(uint _itemCount)
 //	cdebug << "noteAppended(" << _itemCount << ")";
 	while (m_listStack.size())
 	{
-		assert(m_listStack.back().first >= _itemCount);
-		m_listStack.back().first -= _itemCount;
-		if (m_listStack.back().first)
+		assert(m_listStack.back().items >= _itemCount);
+		m_listStack.back().items -= _itemCount;
+		if (m_listStack.back().items)
 			break;
 		else
 		{
-			auto p = m_listStack.back().second;
+			// Write the header at the end of the reserved space, right before the list's payload, which then stays put.
+			OpenList l = m_listStack.back();
 			m_listStack.pop_back();
-			uint s = m_out.size() - p;		// list size
+			uint begin = l.pos + c_listHeaderReserve;
+			uint s = m_out.size() - begin - (m_gapBytes - l.gapBytes);		// list size
 			auto brs = bytesRequired(s);
 			uint encodeSize = s < c_rlpListImmLenCount ? 1 : (1 + brs);
-//			cdebug << "s: " << s << ", p: " << p << ", m_out.size(): " << m_out.size() << ", encodeSize: " << encodeSize << " (br: " << brs << ")";
-			auto os = m_out.size();
-			m_out.resize(os + encodeSize);
-			memmove(m_out.data() + p + encodeSize, m_out.data() + p, os - p);
+//			cdebug << "s: " << s << ", p: " << l.pos << ", m_out.size(): " << m_out.size() << ", encodeSize: " << encodeSize << " (br: " << brs << ")";
+			byte* h = m_out.data() + begin - encodeSize;
 			if (s < c_rlpListImmLenCount)
-				m_out[p] = (byte)(c_rlpListStart + s);
+				*h = (byte)(c_rlpListStart + s);
 			else
 			{
-				m_out[p] = (byte)(c_rlpListIndLenZero + brs);
-				byte* b = &(m_out[p + brs]);
+				*h = (byte)(c_rlpListIndLenZero + brs);
+				byte* b = h + brs;
 				for (; s; s >>= 8)
 					*(b--) = (byte)s;
 			}
+			m_gaps.push_back(make_pair(l.pos, c_listHeaderReserve - encodeSize));
+			m_gapBytes += c_listHeaderReserve - encodeSize;
 		}
 		_itemCount = 1;	// for all following iterations, we've effectively appended a single item only since we completed a list.
 	}
+	if (m_listStack.empty() && m_gaps.size())
+		removeGaps();
+}
+
+void RLPStream::removeGaps()
+{
+	sort(m_gaps.begin(), m_gaps.end());
+	uint to = m_gaps[0].first;
+	for (unsigned i = 0; i < m_gaps.size(); ++i)
+	{
+		uint from = m_gaps[i].first + m_gaps[i].second;
+		uint end = i + 1 < m_gaps.size() ? m_gaps[i + 1].first : m_out.size();
+		if (to != from)
+			memmove(m_out.data() + to, m_out.data() + from, end - from);
+		to += end - from;
+	}
+	m_out.resize(to);
+	m_gaps.clear();
+	m_gapBytes = 0;
 }
 
 RLPStream& RLPStream::appendList(uint _items)
 {
 //	cdebug << "appendList(" << _items << ")";
 	if (_items)
-		m_listStack.push_back(std::make_pair(_items, m_out.size()));
+	{
+		m_listStack.push_back(OpenList{_items, m_out.size(), m_gapBytes});
+		m_out.resize(m_out.size() + c_listHeaderReserve);
+	}
 	else
 		appendList(bytes());
 	return *this;
@@ -246,6 +379,15 @@ RLPStream& RLPStream::append(bytesConstRef _s, bool _compact)
 	return *this;
 }
 
+RLPStream& RLPStream::append(uint _i)
+{
+	byte b[sizeof(uint)];
+	uint br = bytesRequired(_i);
+	for (uint i = br; i; _i >>= 8)
+		b[--i] = (byte)_i;
+	return append(bytesConstRef(b, br));
+}
+
 RLPStream& RLPStream::append(bigint _i)
 {
 	if (!_i)
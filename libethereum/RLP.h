@@ -60,6 +60,8 @@ static const byte c_rlpListIndLenZero = c_rlpListStart + c_rlpListImmLenCount -
  */
 class RLP
 {
+	friend class RLPListView;
+
 public:
 	/// Construct a null node.
 	RLP() {}
@@ -121,7 +123,7 @@ public:
 
 	/// Subscript operator.
 	/// @returns the list item @a _i if isList() and @a _i < listItems(), or RLP() otherwise.
-	/// @note if used to access items in ascending order, this is efficient.
+	/// @note if used to access items in ascending order, this is efficient. Otherwise use an RLPListView.
 	RLP operator[](uint _i) const;
 
 	typedef RLP element_type;
@@ -254,6 +256,117 @@ private:
 	mutable bytesConstRef m_lastItem;
 };
 
+/**
+ * @brief Strict, single-pass check of untrusted RLP.
+ * Walks the entire tree without throwing: every header must be in its shortest form, every item must lie within its
+ * parent, nothing may follow the root item and lists may nest no deeper than a given limit. Items are recorded in
+ * pre-order as they are found, so a valid tree can afterwards be walked without any of those checks being redone.
+ * Refers to the data given; it must outlive the validator.
+ */
+class RLPValidator
+{
+public:
+	enum Result
+	{
+		Valid = 0,
+		Empty,			///< No data at all.
+		TooLarge,		///< More data than offsets can be recorded for.
+		Truncated,		///< An item's header or payload runs past the end of its parent.
+		NonCanonical,	///< A length is not given in its shortest form.
+		TooDeep,		///< Lists are nested more deeply than allowed.
+		TrailingData	///< There are bytes left over after the root item.
+	};
+
+	/// An item found in the tree; offsets are from the start of the data.
+	struct Item
+	{
+		uint32_t begin;		///< Offset of the item's header.
+		uint32_t payload;	///< Offset of the item's payload.
+		uint32_t end;		///< Offset just past the item.
+		uint32_t next;		///< Index of the first item that follows this one and all it contains.
+		bool isList;
+	};
+
+	/// Deepest nesting of lists allowed by default; far more than any protocol message needs.
+	static const unsigned c_defaultMaxDepth = 64;
+
+	/// Validate @a _data, which should contain exactly one RLP item, allowing @a _maxDepth levels of nested lists.
+	explicit RLPValidator(bytesConstRef _data, unsigned _maxDepth = c_defaultMaxDepth);
+
+	/// @returns true iff the data is a single, well-formed and canonical RLP item.
+	bool isValid() const { return m_result == Valid; }
+
+	/// @returns the reason the data was rejected, or Valid.
+	Result result() const { return m_result; }
+
+	/// @returns the offset into the data at which a problem was found, or zero if valid.
+	uint errorOffset() const { return m_errorOffset; }
+
+	/// @returns all items in the tree in pre-order, the root first. Empty unless valid.
+	std::vector<Item> const& items() const { return m_items; }
+
+	/// @returns the item @a _i as an RLP. @a _i must be less than items().size().
+	RLP item(uint _i) const { return RLP(m_data.cropped(m_items[_i].begin, m_items[_i].end - m_items[_i].begin)); }
+
+	/// @returns the root item as an RLP, or RLP() if not valid.
+	RLP root() const { return isValid() ? item(0) : RLP(); }
+
+	/// @returns the data being validated.
+	bytesConstRef data() const { return m_data; }
+
+private:
+	/// Walk the tree, recording items until done or the data is found wanting.
+	void validate(unsigned _maxDepth);
+
+	/// Reject the data as @a _r because of what's at @a _offset.
+	void fail(Result _r, uint _offset);
+
+	bytesConstRef m_data;
+	std::vector<Item> m_items;
+	Result m_result = Valid;
+	uint m_errorOffset = 0;
+};
+
+/**
+ * @brief Random access to the items of an RLP list.
+ * The list is scanned once, on construction, noting where each item begins; counting and indexing are then constant
+ * time. The offsets for lists of up to c_inlineItems items (enough for a trie branch node) are kept in the object itself.
+ * Refers to the same data as the RLP it was made from.
+ */
+class RLPListView
+{
+public:
+	/// Construct an empty view.
+	RLPListView() {}
+
+	/// Construct a view of the list @a _list. Anything that isn't a list has no items.
+	explicit RLPListView(RLP const& _list);
+
+	/// Construct a view of the item @a _item of a valid tree, using the structure already recorded rather than scanning.
+	explicit RLPListView(RLPValidator const& _tree, uint _item = 0);
+
+	/// @returns the number of items in the list.
+	uint size() const { return m_count; }
+
+	/// @returns the list item @a _i if @a _i < size(), or RLP() otherwise.
+	RLP operator[](uint _i) const { return _i < m_count ? RLP(m_payload.cropped(offset(_i), offset(_i + 1) - offset(_i))) : RLP(); }
+
+	/// Greatest number of items whose offsets are kept without allocating.
+	static const uint c_inlineItems = 17;
+
+private:
+	/// Note that the next item ends at offset @a _end into the payload.
+	void noteEnd(uint _end) { if (m_count < c_inlineItems) m_inline[m_count + 1] = (uint32_t)_end; else m_spill.push_back((uint32_t)_end); ++m_count; }
+
+	/// @returns the offset into the payload of item @a _i (or of its end, if @a _i == size()).
+	uint offset(uint _i) const { return _i <= c_inlineItems ? m_inline[_i] : m_spill[_i - c_inlineItems - 1]; }
+
+	bytesConstRef m_payload;
+	uint m_count = 0;
+	std::array<uint32_t, c_inlineItems + 1> m_inline;
+	std::vector<uint32_t> m_spill;
+};
+
 /**
  * @brief Class for writing to an RLP bytestream.
  */
@@ -269,9 +382,9 @@ public:
 	~RLPStream() {}
 
 	/// Append given datum to the byte stream.
-	RLPStream& append(uint _s) { return append(bigint(_s)); }
-	RLPStream& append(u160 _s) { return append(bigint(_s)); }
-	RLPStream& append(u256 _s) { return append(bigint(_s)); }
+	RLPStream& append(uint _s);
+	RLPStream& append(u160 const& _s) { return appendFixed(_s); }
+	RLPStream& append(u256 const& _s) { return appendFixed(_s); }
 	RLPStream& append(bigint _s);
 	RLPStream& append(bytesConstRef _s, bool _compact = false);
 	RLPStream& append(bytes const& _s) { return append(bytesConstRef(&_s)); }
@@ -299,8 +412,11 @@ public:
 	/// Shift operators for appending data items.
 	template <class T> RLPStream& operator<<(T _data) { return append(_data); }
 
+	/// Make room for a further @a _size bytes of output, holding @a _lists lists (each briefly needs some extra space).
+	void reserve(uint _size, uint _lists = 1) { m_out.reserve(m_out.size() + _size + _lists * c_listHeaderReserve); }
+
 	/// Clear the output stream so far.
-	void clear() { m_out.clear(); m_listStack.clear(); }
+	void clear() { m_out.clear(); m_listStack.clear(); m_gaps.clear(); m_gapBytes = 0; }
 
 	/// Read the byte stream.
 	bytes const& out() const { assert(m_listStack.empty()); return m_out; }
@@ -309,8 +425,39 @@ public:
 	void swapOut(bytes& _dest) { assert(m_listStack.empty()); swap(m_out, _dest); }
 
 private:
+	/// A list still being appended to.
+	struct OpenList
+	{
+		uint items;		///< Number of items yet to be appended.
+		uint pos;		///< Offset in m_out of the space reserved for its header.
+		uint gapBytes;	///< m_gapBytes when it was begun.
+	};
+
 	void noteAppended(uint _itemCount = 1);
 
+	/// Close up the space left unused by list headers shorter than the reserve. Each byte is moved at most once.
+	void removeGaps();
+
+	/// Append a fixed-width integer, writing its limbs straight out big-endian rather than going through bigint.
+	template <class _T> RLPStream& appendFixed(_T const& _i)
+	{
+		using limb = boost::multiprecision::limb_type;
+		auto const& be = _i.backend();
+		unsigned limbs = be.size();
+		uint top = (uint)be.limbs()[limbs - 1];
+		uint br = (limbs - 1) * sizeof(limb) + bytesRequired(top);
+
+		byte b[intTraits<_T>::maxSize + sizeof(limb)];
+		byte* d = b + sizeof(b);
+		for (unsigned i = 0; i < limbs; ++i)
+		{
+			limb l = be.limbs()[i];
+			for (unsigned j = 0; j < sizeof(limb); ++j, l >>= 8)
+				*--d = (byte)l;
+		}
+		return append(bytesConstRef(b + sizeof(b) - br, br));
+	}
+
 	/// Push the node-type byte (using @a _base) along with the item count @a _count.
 	/// @arg _count is number of characters for strings, data-bytes for ints, or items for lists.
 	void pushCount(uint _count, byte _offset);
@@ -331,11 +478,28 @@ private:
 		for (; _i != 0; ++i, _i >>= 8) {}
 		return i;
 	}
+	static uint bytesRequired(uint _i)
+	{
+#if defined(__GNUC__)
+		return _i ? 8 - __builtin_clzll(_i) / 8 : 0;
+#else
+		uint i = 0;
+		for (; _i; ++i, _i >>= 8) {}
+		return i;
+#endif
+	}
 
 	/// Our output byte stream.
 	bytes m_out;
 
-	std::vector<std::pair<uint, uint>> m_listStack;
+	std::vector<OpenList> m_listStack;
+
+	/// Unused space (offset, size) in m_out before the headers of completed lists; removed once the outermost list completes.
+	std::vector<std::pair<uint, uint>> m_gaps;
+	uint m_gapBytes = 0;
+
+	/// Space reserved at the start of each list for its header, which can only be written once the list completes.
+	static const uint c_listHeaderReserve = 1 + c_rlpMaxLengthBytes;
 };
 
 template <class _T> void rlpListAux(RLPStream& _out, _T _t) { _out << _t; }
@@ -353,6 +517,28 @@ template <class ... _Ts> bytes rlpList(_Ts ... _ts)
 	return out.out();
 }
 
+/// @returns the number of bytes needed to hold @a _i big-endian, with no leading zeroes.
+constexpr uint rlpBytesRequired(uint _i) { return _i ? 1 + rlpBytesRequired(_i >> 8) : 0; }
+
+/// @returns the size of the header of a list, or of data other than a single byte below 0x80, with @a _payload bytes.
+constexpr uint rlpHeaderSize(uint _payload) { return _payload < c_rlpDataImmLenCount ? 1 : 1 + rlpBytesRequired(_payload); }
+
+/// @returns the total size of a list, or of data other than a single byte below 0x80, with @a _payload bytes.
+constexpr uint rlpItemSize(uint _payload) { return rlpHeaderSize(_payload) + _payload; }
+
+/// @returns the number of bytes RLPStream uses to encode the given value; for exact reservation of output space.
+constexpr uint rlpSize(uint _i) { return _i < c_rlpDataImmLenStart ? 1 : 1 + rlpBytesRequired(_i); }
+template <class _T> uint rlpIntSize(_T const& _i) { return _i < c_rlpDataImmLenStart ? 1 : 1 + (uint)boost::multiprecision::msb(_i) / 8 + 1; }
+inline uint rlpSize(u160 const& _i) { return rlpIntSize(_i); }
+inline uint rlpSize(u256 const& _i) { return rlpIntSize(_i); }
+inline uint rlpSize(bigint const& _i) { return rlpIntSize(_i); }
+inline uint rlpSize(bytesConstRef _d) { return _d.size() == 1 && _d[0] < c_rlpDataImmLenStart ? 1 : rlpItemSize(_d.size()); }
+inline uint rlpSize(bytes const& _d) { return rlpSize(bytesConstRef(&_d)); }
+inline uint rlpSize(std::string const& _s) { return rlpSize(bytesConstRef(_s)); }
+template <unsigned N> uint rlpSize(FixedHash<N> const&) { return rlpItemSize(N); }
+template <class _T> uint rlpSize(std::vector<_T> const& _s) { uint ret = 0; for (auto const& i: _s) ret += rlpSize(i); return rlpItemSize(ret); }
+template <class _T, size_t S> uint rlpSize(std::array<_T, S> const& _s) { uint ret = 0; for (auto const& i: _s) ret += rlpSize(i); return rlpItemSize(ret); }
+
 /// The empty string in RLP format.
 extern bytes RLPNull;
 
@@ -0,0 +1,169 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file RLPSchema.h
+ * @author agent <agent@local>
+ * @date 2014
+ *
+ * Compile-time description of how a struct maps onto an RLP list.
+ */
+
+#pragma once
+
+#include "RLP.h"
+
+namespace eth
+{
+
+/// Decode a single RLP item into a value of the appropriate type. @throws RLPException if it's not of that type.
+template <class _T> void decodeRLPItem(RLP const& _r, _T& o_v) { o_v = _r.toInt<_T>(); }
+template <unsigned _N> void decodeRLPItem(RLP const& _r, FixedHash<_N>& o_v) { o_v = _r.toHash<FixedHash<_N>>(); }
+inline void decodeRLPItem(RLP const& _r, bytes& o_v) { o_v = _r.toBytes(); }
+inline void decodeRLPItem(RLP const& _r, bytesConstRef& o_v) { o_v = _r.toBytesConstRef(); }
+inline void decodeRLPItem(RLP const& _r, std::string& o_v) { o_v = _r.toString(); }
+template <class _T> void decodeRLPItem(RLP const& _r, std::vector<_T>& o_v)
+{
+	if (!_r.isList())
+		throw BadCast();
+	o_v.clear();
+	for (auto const& i: _r)
+	{
+		o_v.push_back(_T());
+		decodeRLPItem(i, o_v.back());
+	}
+}
+
+/**
+ * @brief One item of an RLP list, held in the member @a _M of @a _T.
+ * A bytesConstRef member is left referring to the data decoded from, which must then outlive it.
+ */
+template <class _T, class _V, _V _T::* _M>
+struct RLPField
+{
+	static const unsigned c_items = 1;
+
+	static void decode(_T& o_t, RLP::iterator& io_it, RLP::iterator const& _end, int& io_field)
+	{
+		if (io_it == _end)
+			throw BadCast();
+		decodeRLPItem(*io_it, o_t.*_M);
+		++io_it;
+		++io_field;
+	}
+
+	static void encode(RLPStream& _s, _T const& _t, unsigned& io_items)
+	{
+		if (io_items)
+		{
+			_s << _t.*_M;
+			--io_items;
+		}
+	}
+
+	static uint size(_T const& _t, unsigned& io_items)
+	{
+		if (!io_items)
+			return 0;
+		--io_items;
+		return rlpSize(_t.*_M);
+	}
+};
+
+/**
+ * @brief The items of the member @a _M of @a _T, laid out according to @a _Schema, spliced into the enclosing list.
+ */
+template <class _T, class _V, _V _T::* _M, class _Schema>
+struct RLPInline
+{
+	static const unsigned c_items = _Schema::c_items;
+
+	static void decode(_T& o_t, RLP::iterator& io_it, RLP::iterator const& _end, int& io_field) { _Schema::decodeItems(o_t.*_M, io_it, _end, io_field); }
+	static void encode(RLPStream& _s, _T const& _t, unsigned& io_items) { _Schema::encodeItems(_s, _t.*_M, io_items); }
+	static uint size(_T const& _t, unsigned& io_items) { return _Schema::itemsSize(_t.*_M, io_items); }
+};
+
+/// Shorthand for the RLPField of the member @a M of struct @a S.
+#define ETH_RLP_FIELD(S, M) eth::RLPField<S, decltype(S::M), &S::M>
+
+/**
+ * @brief The layout of an RLP list: its items, in order, each an RLPField or RLPInline.
+ * Decoding makes one pass over the list, converting each item straight into its member; encoding likewise writes each
+ * member directly, and size() says beforehand how much it will write. Items beyond those described are ignored when
+ * decoding.
+ */
+template <class... _Fields> struct RLPSchema;
+
+template <>
+struct RLPSchema<>
+{
+	static const unsigned c_items = 0;
+
+	template <class _T> static void decodeItems(_T&, RLP::iterator&, RLP::iterator const&, int&) {}
+	template <class _T> static void encodeItems(RLPStream&, _T const&, unsigned&) {}
+	template <class _T> static uint itemsSize(_T const&, unsigned&) { return 0; }
+};
+
+template <class _F, class... _Fields>
+struct RLPSchema<_F, _Fields...>
+{
+	typedef RLPSchema<_Fields...> Rest;
+
+	static const unsigned c_items = _F::c_items + Rest::c_items;
+
+	template <class _T> static void decodeItems(_T& o_t, RLP::iterator& io_it, RLP::iterator const& _end, int& io_field)
+	{
+		_F::decode(o_t, io_it, _end, io_field);
+		Rest::decodeItems(o_t, io_it, _end, io_field);
+	}
+
+	template <class _T> static void encodeItems(RLPStream& _s, _T const& _t, unsigned& io_items)
+	{
+		_F::encode(_s, _t, io_items);
+		Rest::encodeItems(_s, _t, io_items);
+	}
+
+	template <class _T> static uint itemsSize(_T const& _t, unsigned& io_items)
+	{
+		uint ret = _F::size(_t, io_items);
+		return ret + Rest::itemsSize(_t, io_items);
+	}
+
+	/// Decode the list @a _list into @a o_t.
+	/// @throws RLPException if it isn't a list, is too short or an item can't be converted; @a o_field is then left
+	/// as the index of the item at fault.
+	template <class _T> static void decode(RLP const& _list, _T& o_t, int& o_field)
+	{
+		o_field = 0;
+		if (!_list.isList())
+			throw BadCast();
+		auto it = _list.begin();
+		decodeItems(o_t, it, _list.end(), o_field);
+	}
+
+	template <class _T> static void decode(RLP const& _list, _T& o_t) { int field; decode(_list, o_t, field); }
+
+	/// Write @a _t as a list of its first @a _items items (by default, all of them).
+	template <class _T> static void encode(RLPStream& _s, _T const& _t, unsigned _items = c_items)
+	{
+		_s.appendList(_items);
+		encodeItems(_s, _t, _items);
+	}
+
+	/// @returns the number of bytes encode() would write for the same arguments.
+	template <class _T> static uint size(_T const& _t, unsigned _items = c_items) { return rlpItemSize(itemsSize(_t, _items)); }
+};
+
+}
@@ -25,12 +25,16 @@
 #include <boost/filesystem.hpp>
 #include <time.h>
 #include <random>
+#include <thread>
+#include <atomic>
 #include "BlockChain.h"
+#include "StateCheckpoints.h"
 #include "Instruction.h"
 #include "Exceptions.h"
 #include "Dagger.h"
 #include "Defaults.h"
 #include "VM.h"
+#include "CodeAnalysis.h"
 using namespace std;
 using namespace eth;
 
@@ -94,31 +98,73 @@ State::State(State const& _s):
 	m_transactions(_s.m_transactions),
 	m_transactionSet(_s.m_transactionSet),
 	m_cache(_s.m_cache),
+	m_executions(_s.m_executions),
+	m_compiled(_s.m_compiled),
 	m_previousBlock(_s.m_previousBlock),
 	m_currentBlock(_s.m_currentBlock),
 	m_currentNumber(_s.m_currentNumber),
 	m_ourAddress(_s.m_ourAddress),
 	m_fees(_s.m_fees),
-	m_blockReward(_s.m_blockReward)
+	m_blockReward(_s.m_blockReward),
+	m_checkpoints(_s.m_checkpoints)
 {
+	// m_cache holds only part of the suspended transaction's effects; a copy of it would be no state at all.
+	if (_s.m_suspended)
+		throw SuspendedState();
 }
 
 State& State::operator=(State const& _s)
 {
+	if (_s.m_suspended)
+		throw SuspendedState();
+	m_suspended.reset();
 	m_db = _s.m_db;
 	m_state.open(&m_db, _s.m_state.root());
 	m_transactions = _s.m_transactions;
 	m_transactionSet = _s.m_transactionSet;
 	m_cache = _s.m_cache;
+	m_executions = _s.m_executions;
+	m_compiled = _s.m_compiled;
 	m_previousBlock = _s.m_previousBlock;
 	m_currentBlock = _s.m_currentBlock;
 	m_currentNumber = _s.m_currentNumber;
 	m_ourAddress = _s.m_ourAddress;
 	m_fees = _s.m_fees;
 	m_blockReward = _s.m_blockReward;
+	m_checkpoints = _s.m_checkpoints;
 	return *this;
 }
 
+State::~State()
+{
+}
+
+/// A contract's execution in progress.
+struct State::Execution
+{
+	Execution(State& _s, Address _myAddress, Address _txSender, u256 _txValue, u256s const& _txData);
+
+	VMPool::Lease vm;
+	ExtVM ext;
+	MinerFeeAdder feeAdder;
+	std::string failure;	///< Why the contract code stopped short, if it did.
+};
+
+State::Execution::Execution(State& _s, Address _myAddress, Address _txSender, u256 _txValue, u256s const& _txData):
+	ext(_s, _myAddress, _txSender, _txValue, _txData),
+	feeAdder({&_s, 0})	// will add fee on destruction.
+{
+	auto it = _s.m_compiled.find(_myAddress);
+	if (it != _s.m_compiled.end())
+		vm->setCode(it->second);
+	else if (++_s.m_executions[_myAddress] >= c_compileThreshold)
+	{
+		auto code = CompiledCode::compile(_s.m_cache[_myAddress].memory());
+		_s.m_compiled[_myAddress] = code;
+		vm->setCode(code);
+	}
+}
+
 void State::ensureCached(Address _a, bool _requireMemory, bool _forceCreate) const
 {
 	auto it = m_cache.find(_a);
@@ -177,7 +223,7 @@ bool State::sync(BlockChain const& _bc, h256 _block)
 	{
 		auto b = _bc.block(_block);
 		bi.populate(b);
-		bi.verifyInternals(_bc.block(_block));
+		bi.verifyInternals(b);
 	}
 	catch (...)
 	{
@@ -204,11 +250,21 @@ bool State::sync(BlockChain const& _bc, h256 _block)
 	{
 		// New blocks available, or we've switched to a different branch. All change.
 		// Find most recent state dump and replay what's left.
-		// (Most recent state dump might end up being genesis.)
+		// (Most recent state dump might end up being genesis, or failing that a checkpoint.)
 
+		SyncProgress progress;
 		std::vector<h256> chain;
 		while (bi.stateRoot != BlockInfo::genesis().hash && m_db.lookup(bi.stateRoot).empty())	// while we don't have the state root of the latest block...
 		{
+			if (m_checkpoints)
+			{
+				bytes c = m_checkpoints->get(bi.hash, _bc.details(bi.hash).number);
+				if (c.size() && restore(&c, bi))
+				{
+					progress.fromCheckpoint = true;
+					break;
+				}
+			}
 			chain.push_back(bi.hash);				// push back for later replay.
 			bi.populate(_bc.block(bi.parentHash));	// move to parent.
 		}
@@ -216,9 +272,19 @@ bool State::sync(BlockChain const& _bc, h256 _block)
 		m_previousBlock = bi;
 		resetCurrent();
 
+		progress.from = progress.current = _bc.details(bi.hash).number;
+		progress.to = progress.from + chain.size();
+		if (chain.size())
+			clog(StateChat) << "Replaying" << chain.size() << "blocks from #" << progress.from << (progress.fromCheckpoint ? "(checkpoint)" : "");
+
 		// Iterate through in reverse, playing back each of the blocks.
 		for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+		{
 			playback(_bc.block(*it), true);
+			++progress.current;
+			if (m_onSyncProgress && (progress.current == progress.to || (progress.current - progress.from) % c_syncProgressInterval == 0))
+				m_onSyncProgress(progress);
+		}
 
 		m_currentNumber = _bc.details(_block).number + 1;
 		resetCurrent();
@@ -227,6 +293,101 @@ bool State::sync(BlockChain const& _bc, h256 _block)
 	return ret;
 }
 
+bytes State::checkpoint() const
+{
+	// [ root, [ [ address, account, [ [ key, value ] ... ] ] ... ] ], each account & value just as it is in its trie.
+	TrieDB<Address, Overlay> state(const_cast<Overlay*>(&m_db), m_previousBlock.stateRoot);		// promise we won't alter the overlay! :)
+	vector<pair<Address, bytes>> accounts;
+	for (auto const& i: state)
+		accounts.push_back(make_pair(i.first, i.second.toBytes()));
+
+	RLPStream s(2);
+	s << m_previousBlock.stateRoot;
+	s.appendList(accounts.size());
+	for (auto const& i: accounts)
+	{
+		RLP r(i.second);
+		vector<pair<h256, bytes>> memory;
+		if (r.itemCount() == 3)
+			for (auto const& j: TrieDB<h256, Overlay>(const_cast<Overlay*>(&m_db), r[2].toHash<h256>()))
+				memory.push_back(make_pair(j.first, j.second.toBytes()));
+
+		s.appendList(3) << i.first;
+		s.appendRaw(i.second);
+		s.appendList(memory.size());
+		for (auto const& j: memory)
+			s.appendList(2) << j.first << j.second;
+	}
+	return s.out();
+}
+
+bool State::restore(bytesConstRef _checkpoint, BlockInfo const& _bi)
+{
+	bool ok = false;
+	try
+	{
+		RLP c(_checkpoint);
+		if (c[0].toHash<h256>() == _bi.stateRoot)
+		{
+			ok = true;
+			TrieDB<Address, Overlay> state(&m_db);
+			state.init();
+			for (auto const& i: c[1])
+			{
+				RLP account = i[1];
+				if (account.itemCount() == 3)
+				{
+					TrieDB<h256, Overlay> memory(&m_db);
+					memory.init();
+					for (auto const& j: i[2])
+						memory.insert(j[0].toHash<h256>(), j[1].toBytesConstRef());
+					if (memory.root() != account[2].toHash<h256>())
+					{
+						ok = false;
+						break;
+					}
+				}
+				state.insert(i[0].toHash<Address>(), account.data());
+			}
+			ok = ok && state.root() == _bi.stateRoot;
+		}
+	}
+	catch (...)
+	{
+		cwarn << "Corrupt state checkpoint of" << _bi.hash;
+		ok = false;
+	}
+
+	if (!ok)
+	{
+		// None of what was put in the overlay may reach the DB. The genesis state the constructor put there goes with
+		// it, so that's put back.
+		m_db.rollback();
+		TrieDB<Address, Overlay> genesis(&m_db);
+		genesis.init();
+		eth::commit(genesisState(), m_db, genesis);
+		return false;
+	}
+
+	m_db.commit();
+	clog(StateChat) << "Restored state of" << _bi.hash << "from its checkpoint.";
+	return true;
+}
+
+void State::noteStore(Address _a, u256 _n, u256 _v)
+{
+	if (m_storeLog)
+		(*m_storeLog)[_a][_n] = _v;
+
+	auto it = m_compiled.find(_a);
+	if (it != m_compiled.end() && it->second->covers(_n))
+	{
+		++m_codeStores;
+		m_compiled.erase(it);
+		m_executions.erase(_a);
+	}
+}
+
 map<Address, u256> State::addresses() const
 {
 	map<Address, u256> ret;
@@ -239,11 +400,20 @@ map<Address, u256> State::addresses() const
 	return ret;
 }
 
+void State::rollback()
+{
+	m_suspended.reset();
+	m_cache.clear();
+	forgetCompiled();
+}
+
 void State::resetCurrent()
 {
+	m_suspended.reset();
 	m_transactions.clear();
 	m_transactionSet.clear();
 	m_cache.clear();
+	forgetCompiled();
 	m_currentBlock = BlockInfo();
 	m_currentBlock.coinbaseAddress = m_ourAddress;
 	m_currentBlock.stateRoot = m_previousBlock.stateRoot;
@@ -284,10 +454,19 @@ bool State::cull(TransactionQueue& _tq) const
 	return ret;
 }
 
-bool State::sync(TransactionQueue& _tq)
+bool State::sync(TransactionQueue& _tq, uint64_t _steps, chrono::steady_clock::time_point _deadline)
 {
-	// TRANSACTIONS
 	bool ret = false;
+
+	// Finish off whatever we were in the middle of before starting anything new.
+	if (m_suspended)
+	{
+		ret = true;
+		if (!resume(_steps, _deadline))
+			return ret;
+	}
+
+	// TRANSACTIONS
 	auto ts = _tq.transactions();
 	vector<pair<h256, bytes>> futures;
 
@@ -301,10 +480,12 @@ bool State::sync(TransactionQueue& _tq)
 				// don't have it yet! Execute it now.
 				try
 				{
-					execute(i.second);
+					execute(&i.second, true);
 					ret = true;
 					_tq.noteGood(i);
 					++goodTxs;
+					if (m_suspended && !resume(_steps, _deadline))
+						return ret;
 				}
 				catch (InvalidNonce const& in)
 				{
@@ -345,14 +526,14 @@ u256 State::playback(bytesConstRef _block, bool _fullCommit)
 	}
 }
 
-u256 State::playback(bytesConstRef _block, BlockInfo const& _bi, BlockInfo const& _parent, BlockInfo const& _grandParent, bool _fullCommit)
+u256 State::playback(bytesConstRef _block, BlockInfo const& _bi, BlockInfo const& _parent, BlockInfo const& _grandParent, bool _fullCommit, Addresses const& _senders)
 {
 	m_currentBlock = _bi;
 	m_previousBlock = _parent;
-	return playback(_block, _grandParent, _fullCommit);
+	return playback(_block, _grandParent, _fullCommit, _senders);
 }
 
-u256 State::playback(bytesConstRef _block, BlockInfo const& _grandParent, bool _fullCommit)
+u256 State::playback(bytesConstRef _block, BlockInfo const& _grandParent, bool _fullCommit, Addresses const& _senders)
 {
 	if (m_currentBlock.parentHash != m_previousBlock.hash)
 		throw InvalidParentHash();
@@ -361,8 +542,12 @@ u256 State::playback(bytesConstRef _block, BlockInfo const& _grandParent, bool _
 //	cnote << m_state;
 
 	// All ok with the block generally. Play back the transactions now...
+	unsigned n = 0;
 	for (auto const& i: RLP(_block)[1])
-		execute(i.data());
+	{
+		execute(i.data(), false, n < _senders.size() ? _senders[n] : Address());
+		++n;
+	}
 
 	// Initialise total difficulty calculation.
 	u256 tdIncrease = m_currentBlock.difficulty;
@@ -419,6 +604,9 @@ u256 State::playback(bytesConstRef _block, BlockInfo const& _grandParent, bool _
 // (i.e. all the transactions we executed).
 void State::commitToMine(BlockChain const& _bc)
 {
+	// Can't mine on a half-executed transaction; see it through.
+	finishSuspended();
+
 	if (m_currentBlock.sha3Transactions != h256() || m_currentBlock.sha3Uncles != h256())
 	{
 		Addresses uncleAddresses;
@@ -452,7 +640,12 @@ void State::commitToMine(BlockChain const& _bc)
 
 	applyRewards(uncleAddresses);
 
-	RLPStream txs(m_transactions.size());
+	uint txsSize = 0;
+	for (auto const& i: m_transactions)
+		txsSize += i.rlpSize();
+	RLPStream txs;
+	txs.reserve(rlpItemSize(txsSize), 1 + 2 * m_transactions.size());
+	txs.appendList(m_transactions.size());
 	for (auto const& i: m_transactions)
 		i.fillStream(txs);
 
@@ -489,6 +682,7 @@ MineInfo State::mine(uint _msTimeout)
 
 		// Compile block:
 		RLPStream ret;
+		ret.reserve(rlpItemSize(m_currentBlock.rlpSize(true) + m_currentTxs.size() + m_currentUncles.size()), 2);
 		ret.appendList(3);
 		m_currentBlock.fillStream(ret, true);
 		ret.appendRaw(m_currentTxs);
@@ -598,10 +792,15 @@ map<u256, u256> const& State::contractMemory(Address _contract) const
 }
 
 void State::execute(bytesConstRef _rlp)
+{
+	execute(_rlp, false);
+}
+
+void State::execute(bytesConstRef _rlp, bool _suspend, Address _sender)
 {
 	// Entry point for a user-executed transaction.
 	Transaction t(_rlp);
-	executeBare(t, t.sender());
+	executeBare(t, _sender ? _sender : t.sender(), _suspend);
 
 	// Add to the user-originated transactions that we've executed.
 	// NOTE: Here, contract-originated transactions will not get added to the transaction list.
@@ -611,6 +810,47 @@ void State::execute(bytesConstRef _rlp)
 	m_transactionSet.insert(t.sha3());
 }
 
+vector<ExecutionResult> State::simulate(vector<pair<Transaction, Address>> const& _batch, unsigned _threads) const
+{
+	// Each worker copies us; better to throw here than on their threads.
+	if (m_suspended)
+		throw SuspendedState();
+
+	vector<ExecutionResult> ret(_batch.size());
+	atomic<size_t> next(0);
+	auto work = [&]()
+	{
+		for (size_t i; (i = next++) < _batch.size();)
+		{
+			State s(*this);
+			s.m_storeLog = &ret[i].stores;
+			try
+			{
+				s.executeBare(_batch[i].first, _batch[i].second, false, &ret[i]);
+			}
+			catch (Exception const& _e)
+			{
+				ret[i].error = _e.description();
+			}
+			catch (std::exception const& _e)
+			{
+				ret[i].error = _e.what();
+			}
+		}
+	};
+
+	if (!_threads)
+		_threads = max(thread::hardware_concurrency(), 1u);
+	_threads = (unsigned)min<size_t>(_threads, _batch.size());
+	vector<thread> workers;
+	for (unsigned i = 1; i < _threads; ++i)
+		workers.push_back(thread(work));
+	work();
+	for (auto& w: workers)
+		w.join();
+	return ret;
+}
+
 void State::applyRewards(Addresses const& _uncleAddresses)
 {
 	u256 r = m_blockReward;
@@ -633,7 +873,7 @@ void State::unapplyRewards(Addresses const& _uncleAddresses)
 	subBalance(m_currentBlock.coinbaseAddress, r);
 }
 
-void State::executeBare(Transaction const& _t, Address _sender)
+void State::executeBare(Transaction const& _t, Address _sender, bool _suspend, ExecutionResult* o_result)
 {
 #if ETH_DEBUG
 	commit();
@@ -664,6 +904,12 @@ void State::executeBare(Transaction const& _t, Address _sender)
 		throw NotEnoughCash();
 	}
 
+	if (o_result)
+	{
+		o_result->fee = fee;
+		o_result->success = true;
+	}
+
 	if (_t.receiveAddress)
 	{
 		// Increment associated nonce for sender.
@@ -676,22 +922,19 @@ void State::executeBare(Transaction const& _t, Address _sender)
 		if (isContractAddress(_t.receiveAddress))
 		{
 			// Once we get here, there's no going back.
-			try
-			{
-				MinerFeeAdder feeAdder({this, 0});	// will add fee on destruction.
-				execute(_t.receiveAddress, _sender, _t.value, _t.data, &feeAdder.fee);
-			}
-			catch (VMException const& _e)
-			{
-				clog(StateChat) << "VM Exception: " << _e.description();
-			}
-			catch (Exception const& _e)
-			{
-				clog(StateChat) << "Exception in VM: " << _e.description();
-			}
-			catch (std::exception const& _e)
+			if (_suspend)
+				m_suspended.reset(new Execution(*this, _t.receiveAddress, _sender, _t.value, _t.data));
+			else
 			{
-				clog(StateChat) << "std::exception in VM: " << _e.what();
+				Execution e(*this, _t.receiveAddress, _sender, _t.value, _t.data);
+				uint64_t steps = (uint64_t)-1;
+				run(e, steps, chrono::steady_clock::time_point::max());
+				if (o_result)
+				{
+					o_result->fee += e.feeAdder.fee;
+					o_result->success = e.failure.empty();
+					o_result->error = e.failure;
+				}
 			}
 		}
 	}
@@ -712,6 +955,8 @@ void State::executeBare(Transaction const& _t, Address _sender)
 		subBalance(_sender, _t.value + fee);
 
 		// Set up new account...
+		m_compiled.erase(newAddress);
+		m_executions.erase(newAddress);
 		m_cache[newAddress] = AddressState(_t.value, 0, AddressType::Contract);
 		auto& mem = m_cache[newAddress].memory();
 		for (uint i = 0; i < _t.data.size(); ++i)
@@ -723,6 +968,10 @@ void State::executeBare(Transaction const& _t, Address _sender)
 #else
 			mem[i] = _t.data[i];
 #endif
+
+		// Analyse the code now so that it's to hand (and any pathology noted) by the time it's run.
+		if (CodeAnalysis::analyse(CompiledCode(mem))->isPathological())
+			clog(StateChat) << "Pathological contract code at" << newAddress;
 	}
 
 #if ETH_DEBUG
@@ -731,10 +980,49 @@ void State::executeBare(Transaction const& _t, Address _sender)
 #endif
 }
 
-void State::execute(Address _myAddress, Address _txSender, u256 _txValue, u256s const& _txData, u256* _totalFee)
+bool State::run(Execution& _exec, uint64_t& io_steps, chrono::steady_clock::time_point _deadline)
+{
+	auto startCount = _exec.vm->stepCount();
+	bool ret = true;
+	try
+	{
+		ret = _exec.vm->go(_exec.ext, io_steps, _deadline);
+	}
+	catch (VMException const& _e)
+	{
+		clog(StateChat) << "VM Exception: " << _e.description();
+		_exec.failure = _e.description();
+	}
+	catch (Exception const& _e)
+	{
+		clog(StateChat) << "Exception in VM: " << _e.description();
+		_exec.failure = _e.description();
+	}
+	catch (std::exception const& _e)
+	{
+		clog(StateChat) << "std::exception in VM: " << _e.what();
+		_exec.failure = _e.what();
+	}
+	// Whether it stopped or threw, the execution's over and what it paid for its steps so far is spent.
+	if (ret)
+		_exec.feeAdder.fee = _exec.vm->runFee();
+	io_steps -= min<uint64_t>(io_steps, _exec.vm->stepCount() - startCount);
+	return ret;
+}
+
+void State::finishSuspended()
 {
-	VM vm;
-	ExtVM evm(*this, _myAddress, _txSender, _txValue, _txData);
-	vm.go(evm);
-	*_totalFee = vm.runFee();
+	if (m_suspended)
+	{
+		uint64_t steps = (uint64_t)-1;
+		resume(steps, chrono::steady_clock::time_point::max());
+	}
+}
+
+bool State::resume(uint64_t& io_steps, chrono::steady_clock::time_point _deadline)
+{
+	if (!run(*m_suspended, io_steps, _deadline))
+		return false;
+	m_suspended.reset();
+	return true;
 }
@@ -23,6 +23,9 @@
 
 #include <array>
 #include <map>
+#include <chrono>
+#include <memory>
+#include <functional>
 #include <unordered_map>
 #include "Common.h"
 #include "RLP.h"
@@ -35,11 +38,13 @@
 #include "FeeStructure.h"
 #include "Dagger.h"
 #include "ExtVMFace.h"
+#include "CompiledCode.h"
 
 namespace eth
 {
 
 class BlockChain;
+class StateCheckpoints;
 
 extern u256 c_genesisDifficulty;
 std::map<Address, AddressState> const& genesisState();
@@ -48,6 +53,24 @@ static const std::map<u256, u256> EmptyMapU256U256;
 
 struct StateChat: public LogChannel { static const char* name() { return "=S="; } static const int verbosity = 4; };
 
+/// The outcome of executing a transaction, as given by State::simulate().
+struct ExecutionResult
+{
+	bool success = false;							///< True if the transaction was valid and any contract code ran without exception.
+	u256 fee;										///< Total fee paid: that of the transaction itself and of running any contract code.
+	std::map<Address, std::map<u256, u256>> stores;	///< Storage written by contract code, by contract and key. Zero values are deletions.
+	std::string error;								///< If it didn't succeed, why not.
+};
+
+/// How far State::sync() has got in replaying the blocks it needs to bring the state up to date.
+struct SyncProgress
+{
+	uint from = 0;					///< Number of the block whose state it started from.
+	uint current = 0;				///< Number of the last block it replayed.
+	uint to = 0;					///< Number of the block it's syncing to.
+	bool fromCheckpoint = false;	///< True if the state it started from was restored from a checkpoint.
+};
+
 class ExtVM;
 
 /**
@@ -65,11 +88,16 @@ public:
 	State(Address _coinbaseAddress, Overlay const& _db);
 
 	/// Copy state object.
+	/// @throws SuspendedState if @a _s isSuspended(); finishSuspended() it first.
 	State(State const& _s);
 
-	/// Copy state object.
+	/// Copy state object. Any transaction of our own that was suspended is dropped.
+	/// @throws SuspendedState if @a _s isSuspended(); finishSuspended() it first.
 	State& operator=(State const& _s);
 
+	/// Destructor.
+	~State();
+
 	/// Set the coinbase address for any transactions we do.
 	/// This causes a complete reset of current block.
 	void setAddress(Address _coinbaseAddress) { m_ourAddress = _coinbaseAddress; resetCurrent(); }
@@ -85,7 +113,7 @@ public:
 	/// Cancels transactions and rolls back the state to the end of the previous block.
 	/// @warning This will only work for on any transactions after you called the last commitToMine().
 	/// It's one or the other.
-	void rollback() { m_cache.clear(); }
+	void rollback();
 
 	/// Prepares the current state for mining.
 	/// Commits all transactions into the trie, compiles uncles and transactions list, applies all
@@ -113,8 +141,29 @@ public:
 	/// Sync with the block chain, but rather than synching to the latest block, instead sync to the given block.
 	bool sync(BlockChain const& _bc, h256 _blockHash);
 
+	/// Have sync() use @a _checkpoints: going back for the latest block whose state is in the DB, it stops at the first
+	/// with a checkpoint instead, restores that state and replays only the blocks after it. Copies share them.
+	void setCheckpoints(StateCheckpoints const* _checkpoints) { m_checkpoints = _checkpoints; }
+
+	/// Have sync() call @a _f every so many blocks it replays, and once it's done. Copies don't inherit it.
+	void onSyncProgress(std::function<void(SyncProgress const&)> const& _f) { m_onSyncProgress = _f; }
+
+	/// @returns the whole state as of the end of the previous block, in the form kept by StateCheckpoints.
+	bytes checkpoint() const;
+
 	/// Sync our transactions, killing those from the queue that we have and assimilating those that we don't.
-	bool sync(TransactionQueue& _tq);
+	/// Contract code is run for at most @a _steps VM steps in total or until @a _deadline; should that run out, the
+	/// transaction is left suspended part way through and the next call to sync() resumes it before doing anything else.
+	/// @returns true if the state changed.
+	bool sync(TransactionQueue& _tq, uint64_t _steps = (uint64_t)-1, std::chrono::steady_clock::time_point _deadline = std::chrono::steady_clock::time_point::max());
+
+	/// @returns true if sync() left a transaction with its contract code only partly executed.
+	/// The transaction is already in pending(), but its effects on the state are incomplete until a later sync() or commitToMine().
+	bool isSuspended() const { return !!m_suspended; }
+
+	/// Run any suspended transaction's contract code through to the end, however long it takes.
+	void finishSuspended();
+
 	/// Like sync but only operate on _tq, killing the invalid/old ones.
 	bool cull(TransactionQueue& _tq) const;
 
@@ -122,6 +171,14 @@ public:
 	void execute(bytes const& _rlp) { return execute(&_rlp); }
 	void execute(bytesConstRef _rlp);
 
+	/// Execute each transaction of @a _batch, with the given sender, on its own throwaway copy of this state,
+	/// spreading the work over @a _threads threads (0 for one per core). Nothing here is changed. The transactions
+	/// needn't be signed but must have the sender's correct nonce.
+	/// @returns the outcome of each transaction, in order.
+	/// @throws SuspendedState if isSuspended(), since there's no complete state to copy.
+	/// @warning This state mustn't be altered (by another thread) until simulate() returns.
+	std::vector<ExecutionResult> simulate(std::vector<std::pair<Transaction, Address>> const& _batch, unsigned _threads = 0) const;
+
 	/// Check if the address is a valid normal (non-contract) account address.
 	bool isNormalAddress(Address _address) const;
 
@@ -166,8 +223,9 @@ public:
 	/// Execute all transactions within a given block.
 	/// @returns the additional total difficulty.
 	/// If the _grandParent is passed, it will check the validity of each of the uncles.
+	/// Any of @a _senders that aren't null are taken to be those of the block's transactions, already recovered.
 	/// This might throw.
-	u256 playback(bytesConstRef _block, BlockInfo const& _bi, BlockInfo const& _parent, BlockInfo const& _grandParent, bool _fullCommit);
+	u256 playback(bytesConstRef _block, BlockInfo const& _bi, BlockInfo const& _parent, BlockInfo const& _grandParent, bool _fullCommit, Addresses const& _senders = Addresses());
 
 	/// Get the fee associated for a contract created with the given data.
 	u256 fee(uint _dataCount) const { return m_fees.m_memoryFee * _dataCount + m_fees.m_newContractFee; }
@@ -199,18 +257,44 @@ private:
 
 	/// Execute the given block, assuming it corresponds to m_currentBlock. If _grandParent is passed, it will be used to check the uncles.
 	/// Throws on failure.
-	u256 playback(bytesConstRef _block, BlockInfo const& _grandParent, bool _fullCommit);
+	u256 playback(bytesConstRef _block, BlockInfo const& _grandParent, bool _fullCommit, Addresses const& _senders = Addresses());
+
+	/// A contract's execution in progress: the VM together with its environment.
+	struct Execution;
+
+	/// Execute a given transaction; if @a _suspend is true, any contract code isn't run but left in m_suspended.
+	/// If @a _sender isn't null, it's taken to be the transaction's rather than being recovered from its signature.
+	void execute(bytesConstRef _rlp, bool _suspend, Address _sender = Address());
 
 	/// Execute a decoded transaction object, given a sender.
 	/// This will append @a _t to the transaction list and change the state accordingly.
-	void executeBare(Transaction const& _t, Address _sender);
+	/// If @a _suspend is true, any contract code isn't run but left in m_suspended for resume().
+	/// If @a o_result is given, the fee paid and whether any contract code succeeded are written to it.
+	void executeBare(Transaction const& _t, Address _sender, bool _suspend = false, ExecutionResult* o_result = nullptr);
+
+	/// Run the contract execution @a _exec until it finishes or @a io_steps or @a _deadline run out; @a io_steps is
+	/// reduced by the steps taken. VM failures are caught and logged: they end the execution.
+	/// @returns true if the execution finished.
+	bool run(Execution& _exec, uint64_t& io_steps, std::chrono::steady_clock::time_point _deadline);
 
-	/// Execute a contract transaction.
-	void execute(Address _myAddress, Address _txSender, u256 _txValue, u256s const& _txData, u256* o_totalFee);
+	/// Carry on with the suspended execution as for run(), dropping it once it finishes.
+	/// @returns true if there is no longer a suspended execution.
+	bool resume(uint64_t& io_steps, std::chrono::steady_clock::time_point _deadline);
 
 	/// Sets m_currentBlock to a clean state, (i.e. no change from m_previousBlock).
 	void resetCurrent();
 
+	/// Put the state given by @a _checkpoint into the DB, so long as it's that of block @a _bi.
+	/// @returns true if it was.
+	bool restore(bytesConstRef _checkpoint, BlockInfo const& _bi);
+
+	/// Note that the contract @a _a has written @a _v to @a _n in its own memory; drops its compiled code (and bumps
+	/// m_codeStores) if that's in range.
+	void noteStore(Address _a, u256 _n, u256 _v);
+
+	/// Forget all compiled contract code and hotness counts; any contract's memory may since have changed.
+	void forgetCompiled() { m_executions.clear(); m_compiled.clear(); }
+
 	/// Finalise the block, applying the earned rewards.
 	void applyRewards(Addresses const& _uncleAddresses);
 
@@ -224,6 +308,12 @@ private:
 
 	mutable std::map<Address, AddressState> m_cache;	///< Our address cache. This stores the states of each address that has (or at least might have) been changed.
 
+	std::map<Address, unsigned> m_executions;	///< Number of times each contract has been executed since its memory was last (re)loaded.
+	std::map<Address, std::shared_ptr<CompiledCode const>> m_compiled;	///< The compiled code of the hot contracts.
+	unsigned m_codeStores = 0;					///< Number of writes into compiled contract code; a VM running compiled code checks it across MKTX.
+	std::unique_ptr<Execution> m_suspended;		///< The contract execution sync() ran out of budget for, if any. Refers into m_cache.
+	std::map<Address, std::map<u256, u256>>* m_storeLog = nullptr;	///< Where to record contract storage writes; set only on simulate()'s copies.
+
 	BlockInfo m_previousBlock;					///< The previous block's information.
 	BlockInfo m_currentBlock;					///< The current block's information.
 	bytes m_currentBytes;						///< The current block.
@@ -239,8 +329,17 @@ private:
 	FeeStructure m_fees;
 	u256 m_blockReward;
 
+	StateCheckpoints const* m_checkpoints = nullptr;				///< Where sync() can find whole states to start from.
+	std::function<void(SyncProgress const&)> m_onSyncProgress;	///< Called as sync() replays blocks.
+
 	static std::string c_defaultPath;
 
+	/// Number of executions after which a contract's code is compiled.
+	static const unsigned c_compileThreshold = 8;
+
+	/// Number of blocks sync() replays between each report of its progress.
+	static const unsigned c_syncProgressInterval = 100;
+
 	friend std::ostream& operator<<(std::ostream& _out, State const& _s);
 };
 
@@ -261,6 +360,7 @@ public:
 	}
 	void setStore(u256 _n, u256 _v)
 	{
+		m_s.noteStore(myAddress, _n, _v);
 		if (_v)
 		{
 #ifdef __clang__
@@ -293,6 +393,7 @@ public:
 	u256 txCount(Address _a) { return m_s.transactionsFrom(_a); }
 	u256 extro(Address _a, u256 _pos) { return m_s.contractMemory(_a, _pos); }
 	u256 extroPrice(Address _a) { return 0; }
+	unsigned codeStores() const { return m_s.m_codeStores; }
 	void suicide(Address _a)
 	{
 		m_s.addBalance(_a, m_s.balance(myAddress) + m_store->size() * fees.m_memoryFee);
@@ -0,0 +1,82 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StateCheckpoints.cpp
+ * @author agent <agent@local>
+ * @date 2014
+ */
+
+#include "StateCheckpoints.h"
+
+#include <boost/filesystem.hpp>
+#include "Defaults.h"
+using namespace std;
+using namespace eth;
+
+/// The key of the checkpoint of block @a _block, numbered @a _number. Being big-endian, the number keeps them in order.
+static string checkpointKey(h256 _block, eth::uint _number)
+{
+	string ret(8, '\0');
+	toBigEndian(_number, ret);
+	return ret + string((char const*)_block.data(), 32);
+}
+
+StateCheckpoints::StateCheckpoints(std::string _path, bool _killExisting)
+{
+	if (_path.empty())
+		_path = Defaults::dbPath();
+	boost::filesystem::create_directories(_path);
+	if (_killExisting)
+		boost::filesystem::remove_all(_path + "/checkpoints");
+
+	ldb::Options o;
+	o.create_if_missing = true;
+	ldb::DB::Open(o, _path + "/checkpoints", &m_db);
+	assert(m_db);
+
+	ldb::Iterator* it = m_db->NewIterator(m_readOptions);
+	it->SeekToLast();
+	if (it->Valid() && it->key().size() == 40)
+		m_latest = fromBigEndian<eth::uint>(bytesConstRef((byte const*)it->key().data(), 8));
+	delete it;
+}
+
+StateCheckpoints::~StateCheckpoints()
+{
+	delete m_db;
+}
+
+void StateCheckpoints::put(h256 _block, eth::uint _number, bytes const& _checkpoint)
+{
+	lock_guard<mutex> l(m_lock);
+	m_db->Put(m_writeOptions, ldb::Slice(checkpointKey(_block, _number)), (ldb::Slice)ref(_checkpoint));
+	m_latest = max(m_latest, _number);
+
+	vector<string> all;
+	ldb::Iterator* it = m_db->NewIterator(m_readOptions);
+	for (it->SeekToFirst(); it->Valid(); it->Next())
+		all.push_back(it->key().ToString());
+	delete it;
+	for (unsigned i = 0; i + c_kept < all.size(); ++i)
+		m_db->Delete(m_writeOptions, ldb::Slice(all[i]));
+}
+
+bytes StateCheckpoints::get(h256 _block, eth::uint _number) const
+{
+	string ret;
+	m_db->Get(m_readOptions, ldb::Slice(checkpointKey(_block, _number)), &ret);
+	return asBytes(ret);
+}
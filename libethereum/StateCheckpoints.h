@@ -0,0 +1,71 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StateCheckpoints.h
+ * @author agent <agent@local>
+ * @date 2014
+ */
+
+#pragma once
+
+#include <mutex>
+#include <leveldb/db.h>
+#include "CommonEth.h"
+namespace ldb = leveldb;
+
+namespace eth
+{
+
+/**
+ * @brief Whole copies of the state as of every so many blocks, each as given by State::checkpoint().
+ * They're kept in their own DB, apart from the state DB, so that if that's lost State::sync() can start from the latest
+ * one on the chain rather than replaying every block from genesis.
+ */
+class StateCheckpoints
+{
+public:
+	StateCheckpoints(bool _killExisting = false): StateCheckpoints(std::string(), _killExisting) {}
+	StateCheckpoints(std::string _path, bool _killExisting = false);
+	~StateCheckpoints();
+
+	/// Keep @a _checkpoint as that of block @a _block, numbered @a _number, dropping the oldest beyond c_kept. Thread-safe.
+	void put(h256 _block, uint _number, bytes const& _checkpoint);
+
+	/// @returns the checkpoint of block @a _block, numbered @a _number, or empty if there's none. Thread-safe.
+	bytes get(h256 _block, uint _number) const;
+
+	/// @returns the number of the latest block with a checkpoint, or 0 if there are none.
+	uint latest() const { std::lock_guard<std::mutex> l(m_lock); return m_latest; }
+
+	/// @returns true if a checkpoint of the state as of block number @a _number is due.
+	bool isDue(uint _number) const { return _number >= latest() + c_interval; }
+
+	/// Blocks between each checkpoint.
+	static const uint c_interval = 1000;
+
+	/// Most checkpoints kept; the oldest go first. More than one, in case the latest is on a branch that's abandoned.
+	static const unsigned c_kept = 4;
+
+private:
+	ldb::DB* m_db = nullptr;
+	uint m_latest = 0;
+	mutable std::mutex m_lock;
+
+	ldb::ReadOptions m_readOptions;
+	ldb::WriteOptions m_writeOptions;
+};
+
+}
@@ -22,25 +22,34 @@
 #include <secp256k1.h>
 #include "vector_ref.h"
 #include "Exceptions.h"
+#include "RLPSchema.h"
 #include "Transaction.h"
 using namespace std;
 using namespace eth;
 
 #define ETH_ADDRESS_DEBUG 0
 
+typedef RLPSchema<
+	ETH_RLP_FIELD(Signature, v),
+	ETH_RLP_FIELD(Signature, r),
+	ETH_RLP_FIELD(Signature, s)
+> SignatureSchema;
+
+typedef RLPSchema<
+	ETH_RLP_FIELD(Transaction, nonce),
+	ETH_RLP_FIELD(Transaction, receiveAddress),
+	ETH_RLP_FIELD(Transaction, value),
+	ETH_RLP_FIELD(Transaction, data),
+	RLPInline<Transaction, Signature, &Transaction::vrs, SignatureSchema>
+> TransactionSchema;
+
 Transaction::Transaction(bytesConstRef _rlpData)
 {
 	int field = 0;
 	RLP rlp(_rlpData);
 	try
 	{
-		nonce = rlp[field = 0].toInt<u256>();
-		receiveAddress = rlp[field = 1].toHash<Address>();
-		value = rlp[field = 2].toInt<u256>();
-		data.reserve(rlp[field = 3].itemCountStrict());
-		for (auto const& i: rlp[3])
-			data.push_back(i.toInt<u256>());
-		vrs = Signature{ rlp[field = 4].toInt<byte>(), rlp[field = 5].toInt<u256>(), rlp[field = 6].toInt<u256>() };
+		TransactionSchema::decode(rlp, *this, field);
 	}
 	catch (RLPException const&)
 	{
@@ -112,10 +121,12 @@ void Transaction::sign(Secret _priv)
 
 void Transaction::fillStream(RLPStream& _s, bool _sig) const
 {
-	_s.appendList(_sig ? 7 : 4);
-	_s << nonce << receiveAddress << value << data;
-	if (_sig)
-		_s << vrs.v << vrs.r << vrs.s;
+	TransactionSchema::encode(_s, *this, _sig ? TransactionSchema::c_items : 4);
+}
+
+eth::uint Transaction::rlpSize(bool _sig) const
+{
+	return TransactionSchema::size(*this, _sig ? TransactionSchema::c_items : 4);
 }
 
 // If the h256 return is an integer, store it in bigendian (i.e. u256 ret; ... return (h256)ret; )
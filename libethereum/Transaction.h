@@ -57,10 +57,12 @@ struct Transaction
 	static h256 kFromMessage(h256 _msg, h256 _priv);
 
 	void fillStream(RLPStream& _s, bool _sig = true) const;
-	bytes rlp(bool _sig = true) const { RLPStream s; fillStream(s, _sig); return s.out(); }
+	/// @returns the number of bytes fillStream() writes.
+	uint rlpSize(bool _sig = true) const;
+	bytes rlp(bool _sig = true) const { RLPStream s; s.reserve(rlpSize(_sig), 2); fillStream(s, _sig); bytes ret; s.swapOut(ret); return ret; }
 	std::string rlpString(bool _sig = true) const { return asString(rlp(_sig)); }
-	h256 sha3(bool _sig = true) const { RLPStream s; fillStream(s, _sig); return eth::sha3(s.out()); }
-	bytes sha3Bytes(bool _sig = true) const { RLPStream s; fillStream(s, _sig); return eth::sha3Bytes(s.out()); }
+	h256 sha3(bool _sig = true) const { return eth::sha3(rlp(_sig)); }
+	bytes sha3Bytes(bool _sig = true) const { return eth::sha3Bytes(rlp(_sig)); }
 };
 
 using Transactions = std::vector<Transaction>;
@@ -148,11 +148,11 @@ public:
 			assert(b.key.size());
 			assert(!(b.key[0] & 0x10));	// should be an integer number of bytes (i.e. not an odd number of nibbles).
 
-			RLP rlp(b.rlp);
-			if (rlp.itemCount() == 2)
-				return std::make_pair(bytesConstRef(b.key).cropped(1), rlp[1].payload());
+			RLPListView items(RLP(b.rlp));
+			if (items.size() == 2)
+				return std::make_pair(bytesConstRef(b.key).cropped(1), items[1].payload());
 			else
-				return std::make_pair(bytesConstRef(b.key).cropped(1), rlp[16].payload());
+				return std::make_pair(bytesConstRef(b.key).cropped(1), items[16].payload());
 		}
 
 	private:
@@ -168,6 +168,7 @@ public:
 
 				Node const& b = m_trail.back();
 				RLP rlp(b.rlp);
+				RLPListView items(rlp);
 
 				if (m_trail.back().child == 255)
 				{
@@ -177,15 +178,15 @@ public:
 						m_trail.pop_back();
 						continue;
 					}
-					if (!(rlp.isList() && (rlp.itemCount() == 2 || rlp.itemCount() == 17)))
+					if (!(rlp.isList() && (items.size() == 2 || items.size() == 17)))
 					{
 						cdebug << b.rlp.size() << toHex(b.rlp);
 						cdebug << rlp;
-						auto c = rlp.itemCount();
+						auto c = items.size();
 						cdebug << c;
-						assert(rlp.isList() && (rlp.itemCount() == 2 || rlp.itemCount() == 17));
+						assert(rlp.isList() && (items.size() == 2 || items.size() == 17));
 					}
-					if (rlp.itemCount() == 2)
+					if (items.size() == 2)
 					{
 						// Just turn it into a valid Branch
 						m_trail.back().key = hexPrefixEncode(keyOf(m_trail.back().key), keyOf(rlp), false);
@@ -197,7 +198,7 @@ public:
 						}
 
 						// enter child.
-						m_trail.back().rlp = m_that->deref(rlp[1]);
+						m_trail.back().rlp = m_that->deref(items[1]);
 						// no need to set .child as 255 - it's already done.
 						continue;
 					}
@@ -211,7 +212,7 @@ public:
 				else
 				{
 					// Continuing/exiting. Look for next...
-					if (!(rlp.isList() && rlp.itemCount() == 17))
+					if (!(rlp.isList() && items.size() == 17))
 					{
 						m_trail.pop_back();
 						continue;
@@ -221,7 +222,7 @@ public:
 				}
 
 				// ...here. should only get here if we're a list.
-				assert(rlp.isList() && rlp.itemCount() == 17);
+				assert(rlp.isList() && items.size() == 17);
 				for (;; m_trail.back().incrementChild())
 					if (m_trail.back().child == 17)
 					{
@@ -229,7 +230,7 @@ public:
 						m_trail.pop_back();
 						break;
 					}
-					else if (!rlp[m_trail.back().child].isEmpty())
+					else if (!items[m_trail.back().child].isEmpty())
 					{
 						if (m_trail.back().child == 16)
 							return;	// have a value at this node - exit now.
@@ -239,7 +240,7 @@ public:
 							// fixed so that Node passed into push_back is constructed *before* m_trail is potentially resized (which invalidates back and rlp)
 							Node const& back = m_trail.back();
 							m_trail.push_back(Node{
-								m_that->deref(rlp[back.child]),
+								m_that->deref(items[back.child]),
 								 hexPrefixEncode(keyOf(back.key), NibbleSlice(bytesConstRef(&back.child, 1), 1), false),
 								 255
 								});
@@ -429,16 +430,17 @@ template <class DB> std::string GenericTrieDB<DB>::atAux(RLP const& _here, Nibbl
 	if (_here.isEmpty() || _here.isNull())
 		// not found.
 		return std::string();
-	assert(_here.isList() && (_here.itemCount() == 2 || _here.itemCount() == 17));
-	if (_here.itemCount() == 2)
+	RLPListView items(_here);
+	assert(_here.isList() && (items.size() == 2 || items.size() == 17));
+	if (items.size() == 2)
 	{
 		auto k = keyOf(_here);
 		if (_key == k && isLeaf(_here))
 			// reached leaf and it's us
-			return _here[1].toString();
+			return items[1].toString();
 		else if (_key.contains(k) && !isLeaf(_here))
 			// not yet at leaf and it might yet be us. onwards...
-			return atAux(_here[1].isList() ? _here[1] : RLP(node(_here[1].toHash<h256>())), _key.mid(k.size()));
+			return atAux(items[1].isList() ? items[1] : RLP(node(items[1].toHash<h256>())), _key.mid(k.size()));
 		else
 			// not us.
 			return std::string();
@@ -446,8 +448,8 @@ template <class DB> std::string GenericTrieDB<DB>::atAux(RLP const& _here, Nibbl
 	else
 	{
 		if (_key.size() == 0)
-			return _here[16].toString();
-		auto n = _here[_key[0]];
+			return items[16].toString();
+		auto n = items[_key[0]];
 		if (n.isEmpty())
 			return std::string();
 		else
@@ -467,8 +469,9 @@ template <class DB> bytes GenericTrieDB<DB>::mergeAt(RLP const& _orig, NibbleSli
 	if (_orig.isEmpty())
 		return place(_orig, _k, _v);
 
-	assert(_orig.isList() && (_orig.itemCount() == 2 || _orig.itemCount() == 17));
-	if (_orig.itemCount() == 2)
+	RLPListView items(_orig);
+	assert(_orig.isList() && (items.size() == 2 || items.size() == 17));
+	if (items.size() == 2)
 	{
 		// pair...
 		NibbleSlice k = keyOf(_orig);
@@ -482,8 +485,8 @@ template <class DB> bytes GenericTrieDB<DB>::mergeAt(RLP const& _orig, NibbleSli
 		{
 			killNode(sha3(_orig.data()));
 			RLPStream s(2);
-			s.append(_orig[0]);
-			mergeAtAux(s, _orig[1], _k.mid(k.size()), _v);
+			s.append(items[0]);
+			mergeAtAux(s, items[1], _k.mid(k.size()), _v);
 			return s.out();
 		}
 
@@ -512,9 +515,9 @@ template <class DB> bytes GenericTrieDB<DB>::mergeAt(RLP const& _orig, NibbleSli
 		RLPStream r(17);
 		for (byte i = 0; i < 17; ++i)
 			if (i == n)
-				mergeAtAux(r, _orig[i], _k.mid(1), _v);
+				mergeAtAux(r, items[i], _k.mid(1), _v);
 			else
-				r.append(_orig[i]);
+				r.append(items[i]);
 		return r.out();
 	}
 
@@ -571,8 +574,9 @@ template <class DB> bytes GenericTrieDB<DB>::deleteAt(RLP const& _orig, NibbleSl
 	if (_orig.isEmpty())
 		return bytes();
 
-	assert(_orig.isList() && (_orig.itemCount() == 2 || _orig.itemCount() == 17));
-	if (_orig.itemCount() == 2)
+	RLPListView items(_orig);
+	assert(_orig.isList() && (items.size() == 2 || items.size() == 17));
+	if (items.size() == 2)
 	{
 		// pair...
 		NibbleSlice k = keyOf(_orig);
@@ -585,8 +589,8 @@ template <class DB> bytes GenericTrieDB<DB>::deleteAt(RLP const& _orig, NibbleSl
 		if (_k.contains(k))
 		{
 			RLPStream s;
-			s.appendList(2) << _orig[0];
-			if (!deleteAtAux(s, _orig[1], _k.mid(k.size())))
+			s.appendList(2) << items[0];
+			if (!deleteAtAux(s, items[1], _k.mid(k.size())))
 				return bytes();
 			killNode(sha3(_orig.data()));
 			RLP r(s.out());
@@ -603,14 +607,14 @@ template <class DB> bytes GenericTrieDB<DB>::deleteAt(RLP const& _orig, NibbleSl
 		// branch...
 
 		// exactly our node - remove and rejig.
-		if (_k.size() == 0 && !_orig[16].isEmpty())
+		if (_k.size() == 0 && !items[16].isEmpty())
 		{
 			// Kill the node.
 			killNode(sha3(_orig.data()));
 
 			byte used = uniqueInUse(_orig, 16);
 			if (used != 255)
-				if (_orig[used].isList() && _orig[used].itemCount() == 2)
+				if (items[used].isList() && items[used].itemCount() == 2)
 					return graft(RLP(merge(_orig, used)));
 				else
 					return merge(_orig, used);
@@ -618,7 +622,7 @@ template <class DB> bytes GenericTrieDB<DB>::deleteAt(RLP const& _orig, NibbleSl
 			{
 				RLPStream r(17);
 				for (byte i = 0; i < 16; ++i)
-					r << _orig[i];
+					r << items[i];
 				r << "";
 				return r.out();
 			}
@@ -630,11 +634,11 @@ template <class DB> bytes GenericTrieDB<DB>::deleteAt(RLP const& _orig, NibbleSl
 			byte n = _k[0];
 			for (byte i = 0; i < 17; ++i)
 				if (i == n)
-					if (!deleteAtAux(r, _orig[i], _k.mid(1)))	// bomb out if the key didn't turn up.
+					if (!deleteAtAux(r, items[i], _k.mid(1)))	// bomb out if the key didn't turn up.
 						return bytes();
 					else {}
 				else
-					r << _orig[i];
+					r << items[i];
 
 			// check if we ended up leaving the node invalid.
 			RLP rlp(r.out());
@@ -23,6 +23,7 @@
 
 #include <secp256k1.h>
 #include <boost/filesystem.hpp>
+#include <boost/thread/tss.hpp>
 #if WIN32
 #pragma warning(push)
 #pragma warning(disable:4244)
@@ -57,4 +58,46 @@ void VM::reset()
 	m_nextPC = 1;
 	m_stepCount = 0;
 	m_runFee = 0;
+	m_stack.clear();
+	m_temp.clear();
+	m_code.reset();
+}
+
+Public VM::popPoint()
+{
+	Public ret;
+	bytesRef y(ret.data() + 32, 32);
+	toBigEndian(m_stack.back(), y);
+	m_stack.pop_back();
+	bytesRef x(ret.data(), 32);
+	toBigEndian(m_stack.back(), x);
+	m_stack.pop_back();
+	return ret;
+}
+
+void VM::pushPoint(Public const& _p)
+{
+	m_stack.push_back(fromBigEndian<u256>(bytesConstRef(_p.data(), 32)));
+	m_stack.push_back(fromBigEndian<u256>(bytesConstRef(_p.data() + 32, 32)));
+}
+
+/// The idle VMs of each thread.
+static boost::thread_specific_ptr<vector<unique_ptr<VM>>> s_idleVMs;
+
+unique_ptr<VM> VMPool::acquire()
+{
+	if (!s_idleVMs.get())
+		s_idleVMs.reset(new vector<unique_ptr<VM>>);
+	if (s_idleVMs->empty())
+		return unique_ptr<VM>(new VM);
+	unique_ptr<VM> ret = move(s_idleVMs->back());
+	s_idleVMs->pop_back();
+	ret->reset();
+	return ret;
+}
+
+void VMPool::release(unique_ptr<VM>&& _vm)
+{
+	if (s_idleVMs.get() && s_idleVMs->size() < c_maxIdle)
+		s_idleVMs->push_back(move(_vm));
 }
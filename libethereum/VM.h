@@ -22,6 +22,8 @@
 #pragma once
 
 #include <unordered_map>
+#include <memory>
+#include <chrono>
 #include <secp256k1.h>
 #if WIN32
 #pragma warning(push)
@@ -42,6 +44,9 @@
 #include "Instruction.h"
 #include "BlockInfo.h"
 #include "ExtVMFace.h"
+#include "VMProfiler.h"
+#include "CompiledCode.h"
+#include "ECCrypto.h"
 
 namespace eth
 {
@@ -58,6 +63,31 @@ inline u256 fromAddress(Address _a)
 	return (u160)_a;
 }
 
+/**
+ * @brief Temporary (MLOAD/MSTORE) memory of the VM.
+ * Words at indices below c_denseWords live in a flat vector that grows as they are written; any
+ * higher index falls back to a sparse map. Unwritten words read as zero, as with a plain map.
+ */
+class VMMemory
+{
+public:
+	/// @returns the word at index @a _i, or 0 if it has never been written.
+	u256 load(u256 const& _i) const;
+
+	/// Set the word at index @a _i to @a _v.
+	void store(u256 const& _i, u256 const& _v);
+
+	/// Forget all words, but keep any capacity already allocated.
+	void clear() { m_dense.clear(); m_sparse.clear(); }
+
+	/// Words at indices below this are stored densely.
+	static const unsigned c_denseWords = 4096;
+
+private:
+	u256s m_dense;
+	std::map<u256, u256> m_sparse;
+};
+
 /**
  */
 class VM
@@ -68,34 +98,161 @@ public:
 	/// Construct VM object.
 	VM();
 
+	/// Ready the VM for a new execution. The stack and temporary memory are emptied but keep their capacity.
 	void reset();
 
+	/// Execute from @a _code where it covers the PC rather than fetching from the contract's storage.
+	/// The code must be that of the contract being executed; it is dropped by reset().
+	void setCode(std::shared_ptr<CompiledCode const> const& _code) { m_code = _code; }
+
+	/// Execute the contract of @a _ext, yielding once @a _steps instructions have been executed or @a _deadline has passed.
+	/// @returns true if execution finished, false if it yielded. The VM keeps its PC, stack and memory when it yields;
+	/// call go() again with the same @a _ext to carry on where it left off.
 	template <class Ext>
-	void go(Ext& _ext, uint64_t _steps = (uint64_t)-1);
+	bool go(Ext& _ext, uint64_t _steps = (uint64_t)-1, std::chrono::steady_clock::time_point _deadline = std::chrono::steady_clock::time_point::max());
 
 	void require(u256 _n) { if (m_stack.size() < _n) throw StackTooSmall(_n, m_stack.size()); }
 	u256 runFee() const { return m_runFee; }
+	uint64_t stepCount() const { return m_stepCount; }
 
 private:
+	/// @returns the code word at @a _pc.
+	template <class Ext> u256 fetch(Ext& _ext, u256 const& _pc) const { return m_code && m_code->covers(_pc) ? m_code->at(_pc) : _ext.store(_pc); }
+
+	/// Pop a point from the stack, its y coordinate being uppermost.
+	Public popPoint();
+
+	/// Push the point @a _p on to the stack, x coordinate first.
+	void pushPoint(Public const& _p);
+
+	/// Pop a byte count and then as many words as it covers, and hash those bytes (big-endian, first word first).
+	template <class Digest> void hashStack(Digest& _digest, byte* o_hash, unsigned _hashSize);
+
+	std::shared_ptr<CompiledCode const> m_code;
 	u256 m_curPC = 0;
 	u256 m_nextPC = 1;
 	uint64_t m_stepCount = 0;
-	std::map<u256, u256> m_temp;
+	VMMemory m_temp;
 	std::vector<u256> m_stack;
 	u256 m_runFee = 0;
+
+	/// Number of steps between checks of the clock against go()'s deadline.
+	static const unsigned c_deadlineInterval = 64;
+
+	bytes m_hashInput;							///< Serialisation buffer for the hashing instructions; keeps its capacity.
+	CryptoPP::SHA256 m_sha256;
+	CryptoPP::RIPEMD160 m_ripemd160;
+	CryptoPP::SHA3_256 m_sha3;
+};
+
+/**
+ * @brief Per-thread pool of VM objects.
+ * A VM handed back to the pool keeps its stack and memory allocations, so the next execution on the same thread
+ * needn't reallocate them. Nested executions (e.g. through MKTX) simply borrow another VM.
+ */
+class VMPool
+{
+public:
+	/// A VM borrowed from the current thread's pool for the lifetime of this object. The VM is reset before use.
+	class Lease
+	{
+	public:
+		Lease(): m_vm(VMPool::acquire()) {}
+		~Lease() { VMPool::release(std::move(m_vm)); }
+
+		VM& operator*() const { return *m_vm; }
+		VM* operator->() const { return m_vm.get(); }
+
+	private:
+		Lease(Lease const&) = delete;
+		Lease& operator=(Lease const&) = delete;
+
+		std::unique_ptr<VM> m_vm;
+	};
+
+	/// The greatest number of idle VMs each thread keeps around.
+	static const unsigned c_maxIdle = 16;
+
+private:
+	static std::unique_ptr<VM> acquire();
+	static void release(std::unique_ptr<VM>&& _vm);
 };
 
 }
 
 // INLINE:
-template <class Ext> void eth::VM::go(Ext& _ext, uint64_t _steps)
+inline eth::u256 eth::VMMemory::load(u256 const& _i) const
+{
+	if (_i < c_denseWords)
+		return (unsigned)_i < m_dense.size() ? m_dense[(unsigned)_i] : 0;
+	auto it = m_sparse.find(_i);
+	return it == m_sparse.end() ? 0 : it->second;
+}
+
+inline void eth::VMMemory::store(u256 const& _i, u256 const& _v)
 {
-	for (bool stopped = false; !stopped && _steps--; m_curPC = m_nextPC, m_nextPC = m_curPC + 1)
+	if (_i < c_denseWords)
 	{
+		unsigned i = (unsigned)_i;
+		if (i >= m_dense.size())
+		{
+			if (!_v)
+				return;
+			m_dense.resize(i + 1);
+		}
+		m_dense[i] = _v;
+	}
+#ifdef __clang__
+	else
+	{
+		auto it = m_sparse.find(_i);
+		if (it == m_sparse.end())
+			m_sparse.insert(std::make_pair(_i, _v));
+		else
+			it->second = _v;
+	}
+#else
+	else
+		m_sparse[_i] = _v;
+#endif
+}
+
+template <class Digest> void eth::VM::hashStack(Digest& _digest, byte* o_hash, unsigned _hashSize)
+{
+	require(1);
+	uint s = (uint)std::min(m_stack.back(), (u256)(m_stack.size() - 1) * 32);
+	m_stack.pop_back();
+
+	uint words = (s + 31) / 32;
+	m_hashInput.resize(words * 32);
+	for (uint i = 0; i < words; ++i)
+	{
+		bytesRef word(m_hashInput.data() + i * 32, 32);
+		toBigEndian(m_stack.back(), word);
+		m_stack.pop_back();
+	}
+	_digest.Update(m_hashInput.data(), s);
+	_digest.TruncatedFinal(o_hash, _hashSize);		// also readies the digest for reuse.
+}
+
+template <class Ext> bool eth::VM::go(Ext& _ext, uint64_t _steps, std::chrono::steady_clock::time_point _deadline)
+{
+#if ETH_VMTRACE
+	VMProfiler::Run profile(VMProfiler::get(), _ext.myAddress);
+#endif
+	bool timed = _deadline != std::chrono::steady_clock::time_point::max();
+	for (;; m_curPC = m_nextPC, m_nextPC = m_curPC + 1)
+	{
+		// BUDGET... (m_curPC is the next instruction, so we can pick up from here.)
+		if (!_steps--)
+			return false;
+		if (timed && !(m_stepCount % c_deadlineInterval) && std::chrono::steady_clock::now() >= _deadline)
+			return false;
+
 		m_stepCount++;
 
 		// INSTRUCTION...
-		auto rawInst = _ext.store(m_curPC);
+		auto rawInst = fetch(_ext, m_curPC);
 		if (rawInst > 0xff)
 			throw BadInstruction();
 		Instruction inst = (Instruction)(uint8_t)rawInst;
@@ -139,6 +296,9 @@ template <class Ext> void eth::VM::go(Ext& _ext, uint64_t _steps)
 		}
 		_ext.payFee(runFee + storeCostDelta);
 		m_runFee += (u256)runFee;
+#if ETH_VMTRACE
+		profile.step(m_curPC, inst, m_stack.size() ? m_stack.back() : 0, (u256)runFee);
+#endif
 
 		// EXECUTE...
 		switch (inst)
@@ -163,28 +323,28 @@ template <class Ext> void eth::VM::go(Ext& _ext, uint64_t _steps)
 		case Instruction::DIV:
 			require(2);
 			if (!m_stack[m_stack.size() - 2])
-				return;
+				return true;
 			m_stack[m_stack.size() - 2] = m_stack.back() / m_stack[m_stack.size() - 2];
 			m_stack.pop_back();
 			break;
 		case Instruction::SDIV:
 			require(2);
 			if (!m_stack[m_stack.size() - 2])
-				return;
+				return true;
 			(s256&)m_stack[m_stack.size() - 2] = (s256&)m_stack.back() / (s256&)m_stack[m_stack.size() - 2];
 			m_stack.pop_back();
 			break;
 		case Instruction::MOD:
 			require(2);
 			if (!m_stack[m_stack.size() - 2])
-				return;
+				return true;
 			m_stack[m_stack.size() - 2] = m_stack.back() % m_stack[m_stack.size() - 2];
 			m_stack.pop_back();
 			break;
 		case Instruction::SMOD:
 			require(2);
 			if (!m_stack[m_stack.size() - 2])
-				return;
+				return true;
 			(s256&)m_stack[m_stack.size() - 2] = (s256&)m_stack.back() % (s256&)m_stack[m_stack.size() - 2];
 			m_stack.pop_back();
 			break;
@@ -272,39 +432,15 @@ template <class Ext> void eth::VM::go(Ext& _ext, uint64_t _steps)
 			break;
 		case Instruction::SHA256:
 		{
-			require(1);
-			uint s = (uint)std::min(m_stack.back(), (u256)(m_stack.size() - 1) * 32);
-			m_stack.pop_back();
-
-			CryptoPP::SHA256 digest;
-			uint i = 0;
-			for (; s; s = (s >= 32 ? s - 32 : 0), i += 32)
-			{
-				bytes b = toBigEndian(m_stack.back());
-				digest.Update(b.data(), (int)std::min<u256>(32, s));			// b.size() == 32
-				m_stack.pop_back();
-			}
 			std::array<byte, 32> final;
-			digest.TruncatedFinal(final.data(), 32);
+			hashStack(m_sha256, final.data(), 32);
 			m_stack.push_back(fromBigEndian<u256>(final));
 			break;
 		}
 		case Instruction::RIPEMD160:
 		{
-			require(1);
-			uint s = (uint)std::min(m_stack.back(), (u256)(m_stack.size() - 1) * 32);
-			m_stack.pop_back();
-
-			CryptoPP::RIPEMD160 digest;
-			uint i = 0;
-			for (; s; s = (s >= 32 ? s - 32 : 0), i += 32)
-			{
-				bytes b = toBigEndian(m_stack.back());
-				digest.Update(b.data(), (int)std::min<u256>(32, s));			// b.size() == 32
-				m_stack.pop_back();
-			}
 			std::array<byte, 20> final;
-			digest.TruncatedFinal(final.data(), 20);
+			hashStack(m_ripemd160, final.data(), 20);
 			// NOTE: this aligns to right of 256-bit container (low-order bytes).
 			// This won't work if they're treated as byte-arrays and thus left-aligned in a 256-bit container.
 			m_stack.push_back((u256)fromBigEndian<u160>(final));
@@ -316,57 +452,19 @@ template <class Ext> void eth::VM::go(Ext& _ext, uint64_t _steps)
 			// If (S[-2],S[-1]) are a valid point in secp256k1, including both coordinates being less than P, pushes (S[-1],S[-2]) * S[-3], using (0,0) as the point at infinity.
 			// Otherwise, pushes (0,0).
 			require(3);
-
-			bytes pub(1, 4);
-			pub += toBigEndian(m_stack[m_stack.size() - 2]);
-			pub += toBigEndian(m_stack.back());
-			m_stack.pop_back();
+			Public p = popPoint();
+			h256 x = m_stack.back();
 			m_stack.pop_back();
-
-			bytes x = toBigEndian(m_stack.back());
-			m_stack.pop_back();
-
-			if (secp256k1_ecdsa_pubkey_verify(pub.data(), (int)pub.size()))	// TODO: Check both are less than P.
-			{
-				secp256k1_ecdsa_pubkey_tweak_mul(pub.data(), (int)pub.size(), x.data());
-				m_stack.push_back(fromBigEndian<u256>(bytesConstRef(&pub).cropped(1, 32)));
-				m_stack.push_back(fromBigEndian<u256>(bytesConstRef(&pub).cropped(33, 32)));
-			}
-			else
-			{
-				m_stack.push_back(0);
-				m_stack.push_back(0);
-			}
+			pushPoint(ECCrypto::get().mul(p, x) ? p : Public());
 			break;
 		}
 		case Instruction::ECADD:
 		{
 			// ECADD - pops four items and pushes (S[-4],S[-3]) + (S[-2],S[-1]) if both points are valid, otherwise (0,0).
 			require(4);
-
-			bytes pub(1, 4);
-			pub += toBigEndian(m_stack[m_stack.size() - 2]);
-			pub += toBigEndian(m_stack.back());
-			m_stack.pop_back();
-			m_stack.pop_back();
-
-			bytes tweak(1, 4);
-			tweak += toBigEndian(m_stack[m_stack.size() - 2]);
-			tweak += toBigEndian(m_stack.back());
-			m_stack.pop_back();
-			m_stack.pop_back();
-
-			if (secp256k1_ecdsa_pubkey_verify(pub.data(),(int) pub.size()) && secp256k1_ecdsa_pubkey_verify(tweak.data(),(int) tweak.size()))
-			{
-				secp256k1_ecdsa_pubkey_tweak_add(pub.data(), (int)pub.size(), tweak.data());
-				m_stack.push_back(fromBigEndian<u256>(bytesConstRef(&pub).cropped(1, 32)));
-				m_stack.push_back(fromBigEndian<u256>(bytesConstRef(&pub).cropped(33, 32)));
-			}
-			else
-			{
-				m_stack.push_back(0);
-				m_stack.push_back(0);
-			}
+			Public p = popPoint();
+			Public q = popPoint();
+			pushPoint(ECCrypto::get().add(p, q) ? p : Public());
 			break;
 		}
 		case Instruction::ECSIGN:
@@ -391,64 +489,39 @@ template <class Ext> void eth::VM::go(Ext& _ext, uint64_t _steps)
 		}
 		case Instruction::ECRECOVER:
 		{
+			// ECRECOVER - pops four items (message, v, r, s) and pushes the signing public key, or (0,0) if there is none.
 			require(4);
-
-			bytes sig = toBigEndian(m_stack[m_stack.size() - 2]) + toBigEndian(m_stack.back());
+			h256 sigS = m_stack.back();
 			m_stack.pop_back();
+			h256 sigR = m_stack.back();
 			m_stack.pop_back();
-			int v = (int)m_stack.back();
+			u256 v = m_stack.back();
 			m_stack.pop_back();
-			bytes msg = toBigEndian(m_stack.back());
+			h256 msg = m_stack.back();
 			m_stack.pop_back();
 
-			byte pubkey[65];
-			int pubkeylen = 65;
-			if (secp256k1_ecdsa_recover_compact(msg.data(), (int)msg.size(), sig.data(), pubkey, &pubkeylen, 0, v - 27))
-			{
-				m_stack.push_back(0);
-				m_stack.push_back(0);
-			}
-			else
-			{
-				m_stack.push_back(fromBigEndian<u256>(bytesConstRef(&pubkey[1], 32)));
-				m_stack.push_back(fromBigEndian<u256>(bytesConstRef(&pubkey[33], 32)));
-			}
+			Public p;
+			ECCrypto::get().recover(msg, v, sigR, sigS, p);
+			pushPoint(p);
 			break;
 		}
 		case Instruction::ECVALID:
 		{
 			require(2);
-			bytes pub(1, 4);
-			pub += toBigEndian(m_stack[m_stack.size() - 2]);
-			pub += toBigEndian(m_stack.back());
-			m_stack.pop_back();
-			m_stack.pop_back();
-
-			m_stack.back() = secp256k1_ecdsa_pubkey_verify(pub.data(), (int)pub.size()) ? 1 : 0;
+			Public p = popPoint();
+			m_stack.back() = ECCrypto::get().valid(p) ? 1 : 0;
 			break;
 		}
 		case Instruction::SHA3:
 		{
-			require(1);
-			uint s = (uint)std::min(m_stack.back(), (u256)(m_stack.size() - 1) * 32);
-			m_stack.pop_back();
-
-			CryptoPP::SHA3_256 digest;
-			uint i = 0;
-			for (; s; s = (s >= 32 ? s - 32 : 0), i += 32)
-			{
-				bytes b = toBigEndian(m_stack.back());
-				digest.Update(b.data(), (int)std::min<u256>(32, s));			// b.size() == 32
-				m_stack.pop_back();
-			}
 			std::array<byte, 32> final;
-			digest.TruncatedFinal(final.data(), 32);
+			hashStack(m_sha3, final.data(), 32);
 			m_stack.push_back(fromBigEndian<u256>(final));
 			break;
 		}
 		case Instruction::PUSH:
 		{
-			m_stack.push_back(_ext.store(m_curPC + 1));
+			m_stack.push_back(fetch(_ext, m_curPC + 1));
 			m_nextPC = m_curPC + 2;
 			break;
 		}
@@ -490,41 +563,24 @@ template <class Ext> void eth::VM::go(Ext& _ext, uint64_t _steps)
 			break;
 		}*/
 		case Instruction::MLOAD:
-		{
 			require(1);
-#ifdef __clang__
-			auto mFinder = m_temp.find(m_stack.back());
-			if (mFinder != m_temp.end())
-				m_stack.back() = mFinder->second;
-			else
-				m_stack.back() = 0;
-#else
-			m_stack.back() = m_temp[m_stack.back()];
-#endif
+			m_stack.back() = m_temp.load(m_stack.back());
 			break;
-		}
 		case Instruction::MSTORE:
-		{
 			require(2);
-#ifdef __clang__
-			auto mFinder = m_temp.find(m_stack.back());
-			if (mFinder == m_temp.end())
-				m_temp.insert(std::make_pair(m_stack.back(), m_stack[m_stack.size() - 2]));
-			else
-				mFinder->second = m_stack[m_stack.size() - 2];
-#else
-			m_temp[m_stack.back()] = m_stack[m_stack.size() - 2];
-#endif
+			m_temp.store(m_stack.back(), m_stack[m_stack.size() - 2]);
 			m_stack.pop_back();
 			m_stack.pop_back();
 			break;
-		}
 		case Instruction::SLOAD:
 			require(1);
 			m_stack.back() = _ext.store(m_stack.back());
 			break;
 		case Instruction::SSTORE:
 			require(2);
+			// Self-modifying code; carry on from storage.
+			if (m_code && m_code->covers(m_stack.back()))
+				m_code.reset();
 			_ext.setStore(m_stack.back(), m_stack[m_stack.size() - 2]);
 			m_stack.pop_back();
 			m_stack.pop_back();
@@ -580,7 +636,12 @@ template <class Ext> void eth::VM::go(Ext& _ext, uint64_t _steps)
 				m_stack.pop_back();
 			}
 
+			unsigned codeStores = _ext.codeStores();
 			_ext.mktx(t);
+
+			// The transaction may have re-entered us and altered our code.
+			if (m_code && _ext.codeStores() != codeStores)
+				m_code.reset();
 			break;
 		}
 		case Instruction::SUICIDE:
@@ -591,12 +652,10 @@ template <class Ext> void eth::VM::go(Ext& _ext, uint64_t _steps)
 			// ...follow through to...
 		}
 		case Instruction::STOP:
-			return;
+			return true;
 		default:
 			throw BadInstruction();
 		}
 	}
-	if (_steps == (unsigned)-1)
-		throw StepsDone();
 }
 
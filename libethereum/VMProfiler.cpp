@@ -0,0 +1,155 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file VMProfiler.cpp
+ * @author agent <agent@local>
+ * @date 2014
+ */
+
+#include "VMProfiler.h"
+
+#include <iomanip>
+#include <algorithm>
+using namespace std;
+using namespace eth;
+
+VMProfiler::Run::~Run()
+{
+	if (m_lastInst >= 0)
+		m_entries[m_lastInst].time += chrono::duration_cast<chrono::nanoseconds>(chrono::high_resolution_clock::now() - m_last).count();
+	m_profiler.merge(m_address, m_entries);
+}
+
+void VMProfiler::Run::step(u256 const& _pc, Instruction _inst, u256 const& _stackTop, u256 const& _fee)
+{
+	auto now = chrono::high_resolution_clock::now();
+	if (m_lastInst >= 0)
+		m_entries[m_lastInst].time += chrono::duration_cast<chrono::nanoseconds>(now - m_last).count();
+	m_lastInst = (uint8_t)_inst;
+	m_entries[m_lastInst].count++;
+	m_entries[m_lastInst].fees += _fee;
+
+	if (m_profiler.isTracing())
+		m_profiler.trace(m_address, _pc, _inst, _stackTop, _fee);
+
+	// Don't charge the time spent tracing to the instruction.
+	m_last = chrono::high_resolution_clock::now();
+}
+
+VMProfiler& VMProfiler::get()
+{
+	static VMProfiler s_ret;
+	return s_ret;
+}
+
+void VMProfiler::clear()
+{
+	lock_guard<mutex> l(m_lock);
+	m_opcodes = VMProfileEntries();
+	m_contracts.clear();
+}
+
+bool VMProfiler::startTrace(std::string const& _path)
+{
+	lock_guard<mutex> l(m_lock);
+	if (m_trace.is_open())
+		m_trace.close();
+	m_trace.open(_path, ios::out | ios::binary | ios::trunc);
+	m_tracing = m_trace.is_open();
+	return m_tracing;
+}
+
+void VMProfiler::stopTrace()
+{
+	lock_guard<mutex> l(m_lock);
+	m_tracing = false;
+	if (m_trace.is_open())
+		m_trace.close();
+}
+
+VMProfileEntries VMProfiler::opcodes() const
+{
+	lock_guard<mutex> l(m_lock);
+	return m_opcodes;
+}
+
+map<Address, VMProfileEntry> VMProfiler::contracts() const
+{
+	lock_guard<mutex> l(m_lock);
+	return m_contracts;
+}
+
+void VMProfiler::merge(Address const& _a, VMProfileEntries const& _e)
+{
+	VMProfileEntry total;
+	for (auto const& i: _e)
+		total.merge(i);
+	if (!total.count)
+		return;
+
+	lock_guard<mutex> l(m_lock);
+	for (unsigned i = 0; i < _e.size(); ++i)
+		m_opcodes[i].merge(_e[i]);
+	m_contracts[_a].merge(total);
+}
+
+void VMProfiler::trace(Address const& _a, u256 const& _pc, Instruction _inst, u256 const& _stackTop, u256 const& _fee)
+{
+	byte record[c_traceRecordSize];
+	memcpy(record, _a.data(), 20);
+	bytesRef pc(record + 20, 32);
+	toBigEndian(_pc, pc);
+	record[52] = (byte)_inst;
+	bytesRef stackTop(record + 53, 32);
+	toBigEndian(_stackTop, stackTop);
+	bytesRef fee(record + 85, 32);
+	toBigEndian(_fee, fee);
+
+	lock_guard<mutex> l(m_lock);
+	if (m_trace.is_open())
+		m_trace.write((char const*)record, c_traceRecordSize);
+}
+
+void VMProfiler::streamOut(ostream& _out) const
+{
+	auto ops = opcodes();
+	auto cs = contracts();
+
+	vector<unsigned> order;
+	for (unsigned i = 0; i < ops.size(); ++i)
+		if (ops[i].count)
+			order.push_back(i);
+	sort(order.begin(), order.end(), [&](unsigned a, unsigned b) { return ops[a].time > ops[b].time; });
+
+	_out << "Opcodes:" << endl;
+	for (auto i: order)
+	{
+		auto it = c_instructionInfo.find((Instruction)i);
+		_out << "  " << left << setw(16) << (it == c_instructionInfo.end() ? "0x" + toHex(bytes(1, (byte)i)) : it->second.name) << right
+			<< setw(14) << ops[i].count << " steps "
+			<< setw(14) << ops[i].time << " ns "
+			<< setw(10) << (ops[i].time / ops[i].count) << " ns/step  fees " << ops[i].fees << endl;
+	}
+
+	vector<pair<Address, VMProfileEntry>> contracts(cs.begin(), cs.end());
+	sort(contracts.begin(), contracts.end(), [](pair<Address, VMProfileEntry> const& a, pair<Address, VMProfileEntry> const& b) { return a.second.time > b.second.time; });
+
+	_out << "Contracts:" << endl;
+	for (auto const& i: contracts)
+		_out << "  " << i.first << right
+			<< setw(14) << i.second.count << " steps "
+			<< setw(14) << i.second.time << " ns  fees " << i.second.fees << endl;
+}
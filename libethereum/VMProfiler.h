@@ -0,0 +1,125 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file VMProfiler.h
+ * @author agent <agent@local>
+ * @date 2014
+ *
+ * Optional instrumentation of the VM. The hooks in VM::go() are only compiled in when ETH_VMTRACE is set
+ * (configure with -DVMTRACE=1).
+ */
+
+#pragma once
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include "CommonEth.h"
+#include "Instruction.h"
+
+namespace eth
+{
+
+/// Aggregated execution statistics of an opcode or a contract.
+struct VMProfileEntry
+{
+	void merge(VMProfileEntry const& _e) { count += _e.count; time += _e.time; fees += _e.fees; }
+
+	uint64_t count = 0;			///< Number of instructions executed.
+	uint64_t time = 0;			///< Cumulative wall-clock time spent executing them, in nanoseconds.
+	u256 fees = 0;				///< Cumulative run fees charged for them.
+};
+
+using VMProfileEntries = std::array<VMProfileEntry, 256>;
+
+/**
+ * @brief Collects per-opcode and per-contract execution statistics and, optionally, a trace of every step.
+ *
+ * The trace is a flat binary file of fixed-size records, one per step, each made of the contract address (20 bytes),
+ * the PC (32 bytes, big-endian), the opcode (1 byte), the top of the stack (32 bytes, big-endian; zero if empty) and
+ * the run fee of the step (32 bytes, big-endian).
+ */
+class VMProfiler
+{
+public:
+	/// Size in bytes of each trace record.
+	static const unsigned c_traceRecordSize = 20 + 32 + 1 + 32 + 32;
+
+	/// The statistics of a single VM::go() invocation; merged into the profiler when it goes out of scope.
+	class Run
+	{
+	public:
+		Run(VMProfiler& _p, Address const& _a): m_profiler(_p), m_address(_a), m_last(std::chrono::high_resolution_clock::now()) {}
+		~Run();
+
+		/// Note the start of a step executing @a _inst at @a _pc, charging a run fee of @a _fee.
+		void step(u256 const& _pc, Instruction _inst, u256 const& _stackTop, u256 const& _fee);
+
+	private:
+		VMProfiler& m_profiler;
+		Address m_address;
+		VMProfileEntries m_entries;
+		int m_lastInst = -1;
+		std::chrono::high_resolution_clock::time_point m_last;
+	};
+
+	/// The process-wide profiler.
+	static VMProfiler& get();
+
+	/// Forget all statistics gathered so far.
+	void clear();
+
+	/// Start writing a trace of every step to the file @a _path, truncating it.
+	/// @returns false if the file could not be opened.
+	bool startTrace(std::string const& _path);
+
+	/// Stop writing the trace and close its file.
+	void stopTrace();
+
+	/// @returns true if a trace is currently being written.
+	bool isTracing() const { return m_tracing; }
+
+	/// @returns the statistics of each opcode, indexed by its byte value.
+	VMProfileEntries opcodes() const;
+
+	/// @returns the statistics of each contract that has been executed.
+	std::map<Address, VMProfileEntry> contracts() const;
+
+	/// Dump a human-readable summary, most expensive opcodes and contracts first.
+	void streamOut(std::ostream& _out) const;
+
+private:
+	void merge(Address const& _a, VMProfileEntries const& _e);
+	void trace(Address const& _a, u256 const& _pc, Instruction _inst, u256 const& _stackTop, u256 const& _fee);
+
+	mutable std::mutex m_lock;
+	VMProfileEntries m_opcodes;
+	std::map<Address, VMProfileEntry> m_contracts;
+
+	std::atomic<bool> m_tracing{false};
+	std::ofstream m_trace;
+};
+
+inline std::ostream& operator<<(std::ostream& _out, VMProfiler const& _p)
+{
+	_p.streamOut(_out);
+	return _out;
+}
+
+}
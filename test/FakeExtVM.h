@@ -0,0 +1,344 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file FakeExtVM.h
+ * @author agent <agent@local>
+ * @date 2014
+ * In-memory VM environment shared by the VM tests and benchmarks.
+ */
+
+#pragma once
+
+#include <tuple>
+#include "../json_spirit/json_spirit_value.h"
+#include <ExtVMFace.h>
+#include <Transaction.h>
+#include <Instruction.h>
+#include <Log.h>
+
+namespace eth
+{
+
+class FakeExtVM: public ExtVMFace
+{
+public:
+	FakeExtVM()
+	{}
+	FakeExtVM(FeeStructure const& _fees, BlockInfo const& _previousBlock, BlockInfo const& _currentBlock, uint _currentNumber):
+		ExtVMFace(Address(), Address(), 0, u256s(), _fees, _previousBlock, _currentBlock, _currentNumber)
+	{}
+
+	u256 store(u256 _n)
+	{
+#ifdef __clang__
+		std::tuple<u256, u256, u256, std::map<u256, u256> > & address = addresses[myAddress];
+		std::map<u256, u256> & third = std::get<3>(address);
+		auto sFinder = third.find(_n);
+		if (sFinder != third.end())
+			return sFinder->second;
+		else
+			return 0;
+#else
+		return std::get<3>(addresses[myAddress])[_n];
+#endif
+	}
+	void setStore(u256 _n, u256 _v)
+	{
+#ifdef __clang__
+		std::tuple<u256, u256, u256, std::map<u256, u256> > & address = addresses[myAddress];
+		std::map<u256, u256> & third = std::get<3>(address);
+		auto sFinder = third.find(_n);
+		if (sFinder != third.end())
+			sFinder->second = _v;
+		else
+			third.insert(std::make_pair(_n, _v));
+#else
+		std::get<3>(addresses[myAddress])[_n] = _v;
+#endif
+	}
+	void mktx(Transaction& _t)
+	{
+		if (std::get<0>(addresses[myAddress]) >= _t.value)
+		{
+			std::get<0>(addresses[myAddress]) -= _t.value;
+			std::get<1>(addresses[myAddress])++;
+//			std::get<0>(addresses[_t.receiveAddress]) += _t.value;
+			txs.push_back(_t);
+		}
+	}
+	u256 balance(Address _a) { return std::get<0>(addresses[_a]); }
+	void payFee(bigint _fee) { std::get<0>(addresses[myAddress]) = (u256)(std::get<0>(addresses[myAddress]) - _fee); }
+	u256 txCount(Address _a) { return std::get<1>(addresses[_a]); }
+	u256 extro(Address _a, u256 _pos)
+	{
+#ifdef __clang__
+		std::tuple<u256, u256, u256, std::map<u256, u256> > & address = addresses[_a];
+		std::map<u256, u256> & third = std::get<3>(address);
+		auto sFinder = third.find(_pos);
+		if (sFinder != third.end())
+			return sFinder->second;
+		else
+			return 0;
+#else
+		return std::get<3>(addresses[_a])[_pos];
+#endif
+	}
+	u256 extroPrice(Address _a) { return std::get<2>(addresses[_a]); }
+	void suicide(Address _a)
+	{
+		for (auto const& i: std::get<3>(addresses[myAddress]))
+			if (i.second)
+				std::get<0>(addresses[_a]) += fees.m_memoryFee;
+		std::get<0>(addresses[_a]) += std::get<0>(addresses[myAddress]);
+		addresses.erase(myAddress);
+	}
+
+	void setTransaction(Address _txSender, u256 _txValue, u256s const& _txData)
+	{
+		txSender = _txSender;
+		txValue = _txValue;
+		txData = _txData;
+	}
+	void setContract(Address _myAddress, u256 _myBalance, u256 _myNonce, u256s _myData)
+	{
+		myAddress = _myAddress;
+		set(myAddress, _myBalance, _myNonce, _myData);
+	}
+	void set(Address _a, u256 _myBalance, u256 _myNonce, u256s _myData)
+	{
+		std::get<0>(addresses[_a]) = _myBalance;
+		std::get<1>(addresses[_a]) = _myNonce;
+		std::get<2>(addresses[_a]) = 0;
+		for (unsigned i = 0; i < _myData.size(); ++i)
+#ifdef __clang__
+		{
+			std::tuple<u256, u256, u256, std::map<u256, u256> > & address = addresses[_a];
+			std::map<u256, u256> & third = std::get<3>(address);
+			auto sFinder = third.find(i);
+			if (sFinder != third.end())
+				sFinder->second = _myData[i];
+			else
+				third.insert(std::make_pair(i, _myData[i]));
+		}
+#else
+			std::get<3>(addresses[_a])[i] = _myData[i];
+#endif
+	}
+
+	json_spirit::mObject exportEnv()
+	{
+		json_spirit::mObject ret;
+		ret["previousHash"] = toString(previousBlock.hash);
+		ret["previousNonce"] = toString(previousBlock.nonce);
+		push(ret, "currentDifficulty", currentBlock.difficulty);
+		push(ret, "currentTimestamp", currentBlock.timestamp);
+		ret["currentCoinbase"] = toString(currentBlock.coinbaseAddress);
+		push(ret, "feeMultiplier", fees.multiplier());
+		return ret;
+	}
+
+	void importEnv(json_spirit::mObject& _o)
+	{
+		previousBlock.hash = h256(_o["previousHash"].get_str());
+		previousBlock.nonce = h256(_o["previousNonce"].get_str());
+		currentBlock.difficulty = toInt(_o["currentDifficulty"]);
+		currentBlock.timestamp = toInt(_o["currentTimestamp"]);
+		currentBlock.coinbaseAddress = Address(_o["currentCoinbase"].get_str());
+		fees.setMultiplier(toInt(_o["feeMultiplier"]));
+	}
+
+	static u256 toInt(json_spirit::mValue const& _v)
+	{
+		switch (_v.type())
+		{
+		case json_spirit::str_type: return u256(_v.get_str());
+		case json_spirit::int_type: return (u256)_v.get_uint64();
+		case json_spirit::bool_type: return (u256)(uint64_t)_v.get_bool();
+		case json_spirit::real_type: return (u256)(uint64_t)_v.get_real();
+		default: cwarn << "Bad type for scalar: " << _v.type();
+		}
+		return 0;
+	}
+
+	static void push(json_spirit::mObject& o, std::string const& _n, u256 _v)
+	{
+		if (_v < (u256)1 << 64)
+			o[_n] = (uint64_t)_v;
+		else
+			o[_n] = toString(_v);
+	}
+
+	static void push(json_spirit::mArray& a, u256 _v)
+	{
+		if (_v < (u256)1 << 64)
+			a.push_back((uint64_t)_v);
+		else
+			a.push_back(toString(_v));
+	}
+
+	json_spirit::mObject exportState()
+	{
+		json_spirit::mObject ret;
+		for (auto const& a: addresses)
+		{
+			json_spirit::mObject o;
+			push(o, "balance", std::get<0>(a.second));
+			push(o, "nonce", std::get<1>(a.second));
+			push(o, "extroPrice", std::get<2>(a.second));
+
+			json_spirit::mObject store;
+			std::string curKey;
+			u256 li = 0;
+			json_spirit::mArray curVal;
+			for (auto const& s: std::get<3>(a.second))
+			{
+				if (!li || s.first > li + 8)
+				{
+					if (li)
+						store[curKey] = curVal;
+					li = s.first;
+					curKey = toString(li);
+					curVal = json_spirit::mArray();
+				}
+				else
+					for (; li != s.first; ++li)
+						curVal.push_back(0);
+				push(curVal, s.second);
+				++li;
+			}
+			if (li)
+			{
+				store[curKey] = curVal;
+				o["store"] = store;
+			}
+			ret[toString(a.first)] = o;
+		}
+		return ret;
+	}
+
+	void importState(json_spirit::mObject& _o)
+	{
+		for (auto const& i: _o)
+		{
+			json_spirit::mObject o = i.second.get_obj();
+			auto& a = addresses[Address(i.first)];
+			std::get<0>(a) = toInt(o["balance"]);
+			std::get<1>(a) = toInt(o["nonce"]);
+			std::get<2>(a) = toInt(o["extroPrice"]);
+			if (o.count("store"))
+				for (auto const& j: o["store"].get_obj())
+				{
+					u256 adr(j.first);
+					for (auto const& k: j.second.get_array())
+#ifdef __clang__
+					{
+						std::map<u256, u256> & third = std::get<3>(a);
+						auto sFinder = third.find(adr);
+						if (sFinder != third.end())
+							sFinder->second = toInt(k);
+						else
+							third.insert(std::make_pair(adr, toInt(k)));
+						adr++;
+					}
+#else
+						std::get<3>(a)[adr++] = toInt(k);
+#endif
+				}
+			if (o.count("code"))
+			{
+				u256s d = compileLisp(o["code"].get_str());
+				for (unsigned i = 0; i < d.size(); ++i)
+#ifdef __clang__
+				{
+					std::map<u256, u256> & third = std::get<3>(a);
+					auto sFinder = third.find(i);
+					if (sFinder != third.end())
+						sFinder->second = d[i];
+					else
+						third.insert(std::make_pair(i, d[i]));
+				}
+#else
+					std::get<3>(a)[(u256)i] = d[i];
+#endif
+			}
+		}
+	}
+
+	json_spirit::mObject exportExec()
+	{
+		json_spirit::mObject ret;
+		ret["address"] = toString(myAddress);
+		ret["sender"] = toString(txSender);
+		push(ret, "value", txValue);
+		json_spirit::mArray d;
+		for (auto const& i: txData)
+			push(d, i);
+		ret["data"] = d;
+		return ret;
+	}
+
+	void importExec(json_spirit::mObject& _o)
+	{
+		myAddress = Address(_o["address"].get_str());
+		txSender = Address(_o["sender"].get_str());
+		txValue = toInt(_o["value"]);
+		for (auto const& j: _o["data"].get_array())
+			txData.push_back(toInt(j));
+	}
+
+	json_spirit::mArray exportTxs()
+	{
+		json_spirit::mArray ret;
+		for (Transaction const& tx: txs)
+		{
+			json_spirit::mObject o;
+			o["destination"] = toString(tx.receiveAddress);
+			push(o, "value", tx.value);
+			json_spirit::mArray d;
+			for (auto const& i: tx.data)
+				push(d, i);
+			o["data"] = d;
+			ret.push_back(o);
+		}
+		return ret;
+	}
+
+	void importTxs(json_spirit::mArray& _txs)
+	{
+		for (json_spirit::mValue& v: _txs)
+		{
+			auto tx = v.get_obj();
+			Transaction t;
+			t.receiveAddress = Address(tx["destination"].get_str());
+			t.value = toInt(tx["value"]);
+			for (auto const& j: tx["data"].get_array())
+				t.data.push_back(toInt(j));
+			txs.push_back(t);
+		}
+	}
+
+	void reset(u256 _myBalance, u256 _myNonce, u256s _myData)
+	{
+		txs.clear();
+		addresses.clear();
+		set(myAddress, _myBalance, _myNonce, _myData);
+	}
+
+	std::map<Address, std::tuple<u256, u256, u256, std::map<u256, u256>>> addresses;
+	Transactions txs;
+};
+
+}
@@ -24,7 +24,7 @@
 #include "../json_spirit/json_spirit_reader_template.h"
 #include "../json_spirit/json_spirit_writer_template.h"
 #include <Log.h>
-#include <RLP.h>
+#include <RLPSchema.h>
 using namespace std;
 using namespace eth;
 namespace js = json_spirit;
@@ -32,6 +32,15 @@ namespace js = json_spirit;
 namespace eth
 {
 
+struct SchemaTest
+{
+	uint n;
+	bytesConstRef name;
+	h256s hashes;
+};
+
+typedef RLPSchema<ETH_RLP_FIELD(SchemaTest, n), ETH_RLP_FIELD(SchemaTest, name), ETH_RLP_FIELD(SchemaTest, hashes)> SchemaTestSchema;
+
 template <> class UnitTest<2>
 {
 public:
@@ -75,6 +84,52 @@ public:
 				cwarn << "Impl says:" << toHex(s.out());
 				passed = false;
 			}
+			if (!RLPValidator(&s.out()).isValid())
+			{
+				cwarn << "Test failed: output rejected by validator.";
+				passed = false;
+			}
+		}
+
+		// Each of these breaks exactly one of the rules.
+		for (auto const& i: map<string, RLPValidator::Result>{
+			{"", RLPValidator::Empty},
+			{"83646f", RLPValidator::Truncated},
+			{"c283646f67", RLPValidator::Truncated},
+			{"b901", RLPValidator::Truncated},
+			{"8105", RLPValidator::NonCanonical},
+			{"b80100", RLPValidator::NonCanonical},
+			{"f80100", RLPValidator::NonCanonical},
+			{"b9000100", RLPValidator::NonCanonical},
+			{"c0c0", RLPValidator::TrailingData}})
+		{
+			bytes b = fromHex(i.first);
+			if (RLPValidator(&b).result() != i.second)
+			{
+				cwarn << "Test failed: validator accepted or misdiagnosed" << i.first;
+				passed = false;
+			}
+		}
+		bytes deep = rlpList();
+		for (int i = 0; i < 64; ++i)
+			deep = RLPStream(1).appendRaw(&deep).out();
+		if (RLPValidator(&deep).result() != RLPValidator::TooDeep || !RLPValidator(&deep, 65).isValid())
+		{
+			cwarn << "Test failed: validator depth limit.";
+			passed = false;
+		}
+
+		// Round trip through a schema; the bytesConstRef must point into the encoded data rather than a copy.
+		string dog = "dog";
+		SchemaTest st{42, bytesConstRef(dog), h256s{h256(69)}};
+		RLPStream sts;
+		SchemaTestSchema::encode(sts, st);
+		SchemaTest st2;
+		SchemaTestSchema::decode(RLP(sts.out()), st2);
+		if (sts.out() != rlpList(42, dog, st.hashes) || st2.n != 42 || st2.name.toString() != "dog" || st2.hashes != st.hashes || st2.name.data() != sts.out().data() + 3)
+		{
+			cwarn << "Test failed: schema round trip.";
+			passed = false;
 		}
 		return passed ? 0 : 1;
 	}
@@ -24,6 +24,7 @@
 #include <secp256k1.h>
 #include <BlockChain.h>
 #include <State.h>
+#include <StateCheckpoints.h>
 #include <Defaults.h>
 using namespace std;
 using namespace eth;
@@ -71,6 +72,15 @@ int stateTest()
 		assert(t.sender() == myMiner.address());
 		tx = t.rlp();
 	}
+
+	// Dry-run it first; that mustn't change anything.
+	{
+		u256 before = s.balance(myMiner.address());
+		auto r = s.simulate({{Transaction(&tx), myMiner.address()}});
+		assert(r.size() == 1 && r[0].success && r[0].fee == s.fee() && r[0].stores.empty());
+		assert(s.balance(myMiner.address()) == before);
+	}
+
 	s.execute(tx);
 
 	cout << s;
@@ -86,6 +96,18 @@ int stateTest()
 
 	cout << s;
 
+	// Starting again with nothing but a checkpoint of that must get to the same state, without replaying anything.
+	{
+		StateCheckpoints checkpoints(true);
+		checkpoints.put(bc.currentHash(), bc.details().number, s.checkpoint());
+		State fresh(myMiner.address(), Overlay());
+		fresh.setCheckpoints(&checkpoints);
+		bool replayed = false;
+		fresh.onSyncProgress([&](SyncProgress const&) { replayed = true; });
+		fresh.sync(bc);
+		assert(fresh.rootHash() == s.rootHash() && !replayed);
+	}
+
 	return 0;
 }
 
@@ -23,11 +23,11 @@
 #include <fstream>
 #include "../json_spirit/json_spirit_reader_template.h"
 #include "../json_spirit/json_spirit_writer_template.h"
-#include <ExtVMFace.h>
-#include <Transaction.h>
 #include <VM.h>
 #include <Log.h>
 #include <Instruction.h>
+#include <CodeAnalysis.h>
+#include "FakeExtVM.h"
 using namespace std;
 using namespace json_spirit;
 using namespace eth;
@@ -35,315 +35,6 @@ using namespace eth;
 namespace eth
 {
 
-class FakeExtVM: public ExtVMFace
-{
-public:
-	FakeExtVM()
-	{}
-	FakeExtVM(FeeStructure const& _fees, BlockInfo const& _previousBlock, BlockInfo const& _currentBlock, uint _currentNumber):
-		ExtVMFace(Address(), Address(), 0, u256s(), _fees, _previousBlock, _currentBlock, _currentNumber)
-	{}
-
-	u256 store(u256 _n)
-	{
-#ifdef __clang__
-		tuple<u256, u256, u256, map<u256, u256> > & address = addresses[myAddress];
-		map<u256, u256> & third = get<3>(address);
-		auto sFinder = third.find(_n);
-		if (sFinder != third.end())
-			return sFinder->second;
-		else
-			return 0;
-#else
-		return get<3>(addresses[myAddress])[_n];
-#endif
-	}
-	void setStore(u256 _n, u256 _v)
-	{
-#ifdef __clang__
-		tuple<u256, u256, u256, map<u256, u256> > & address = addresses[myAddress];
-		map<u256, u256> & third = get<3>(address);
-		auto sFinder = third.find(_n);
-		if (sFinder != third.end())
-			sFinder->second = _v;
-		else
-			third.insert(std::make_pair(_n, _v));
-#else
-		get<3>(addresses[myAddress])[_n] = _v;
-#endif
-	}
-	void mktx(Transaction& _t)
-	{
-		if (get<0>(addresses[myAddress]) >= _t.value)
-		{
-			get<0>(addresses[myAddress]) -= _t.value;
-			get<1>(addresses[myAddress])++;
-//			get<0>(addresses[_t.receiveAddress]) += _t.value;
-			txs.push_back(_t);
-		}
-	}
-	u256 balance(Address _a) { return get<0>(addresses[_a]); }
-	void payFee(bigint _fee) { get<0>(addresses[myAddress]) = (u256)(get<0>(addresses[myAddress]) - _fee); }
-	u256 txCount(Address _a) { return get<1>(addresses[_a]); }
-	u256 extro(Address _a, u256 _pos)
-	{
-#ifdef __clang__
-		tuple<u256, u256, u256, map<u256, u256> > & address = addresses[_a];
-		map<u256, u256> & third = get<3>(address);
-		auto sFinder = third.find(_pos);
-		if (sFinder != third.end())
-			return sFinder->second;
-		else
-			return 0;
-#else
-		return get<3>(addresses[_a])[_pos];
-#endif
-	}
-	u256 extroPrice(Address _a) { return get<2>(addresses[_a]); }
-	void suicide(Address _a)
-	{
-		for (auto const& i: get<3>(addresses[myAddress]))
-			if (i.second)
-				get<0>(addresses[_a]) += fees.m_memoryFee;
-		get<0>(addresses[_a]) += get<0>(addresses[myAddress]);
-		addresses.erase(myAddress);
-	}
-
-	void setTransaction(Address _txSender, u256 _txValue, u256s const& _txData)
-	{
-		txSender = _txSender;
-		txValue = _txValue;
-		txData = _txData;
-	}
-	void setContract(Address _myAddress, u256 _myBalance, u256 _myNonce, u256s _myData)
-	{
-		myAddress = _myAddress;
-		set(myAddress, _myBalance, _myNonce, _myData);
-	}
-	void set(Address _a, u256 _myBalance, u256 _myNonce, u256s _myData)
-	{
-		get<0>(addresses[_a]) = _myBalance;
-		get<1>(addresses[_a]) = _myNonce;
-		get<2>(addresses[_a]) = 0;
-		for (unsigned i = 0; i < _myData.size(); ++i)
-#ifdef __clang__
-		{
-			tuple<u256, u256, u256, map<u256, u256> > & address = addresses[_a];
-			map<u256, u256> & third = get<3>(address);
-			auto sFinder = third.find(i);
-			if (sFinder != third.end())
-				sFinder->second = _myData[i];
-			else
-				third.insert(std::make_pair(i, _myData[i]));
-		}
-#else
-			get<3>(addresses[_a])[i] = _myData[i];
-#endif
-	}
-
-	mObject exportEnv()
-	{
-		mObject ret;
-		ret["previousHash"] = toString(previousBlock.hash);
-		ret["previousNonce"] = toString(previousBlock.nonce);
-		push(ret, "currentDifficulty", currentBlock.difficulty);
-		push(ret, "currentTimestamp", currentBlock.timestamp);
-		ret["currentCoinbase"] = toString(currentBlock.coinbaseAddress);
-		push(ret, "feeMultiplier", fees.multiplier());
-		return ret;
-	}
-
-	void importEnv(mObject& _o)
-	{
-		previousBlock.hash = h256(_o["previousHash"].get_str());
-		previousBlock.nonce = h256(_o["previousNonce"].get_str());
-		currentBlock.difficulty = toInt(_o["currentDifficulty"]);
-		currentBlock.timestamp = toInt(_o["currentTimestamp"]);
-		currentBlock.coinbaseAddress = Address(_o["currentCoinbase"].get_str());
-		fees.setMultiplier(toInt(_o["feeMultiplier"]));
-	}
-
-	static u256 toInt(mValue const& _v)
-	{
-		switch (_v.type())
-		{
-		case str_type: return u256(_v.get_str());
-		case int_type: return (u256)_v.get_uint64();
-		case bool_type: return (u256)(uint64_t)_v.get_bool();
-		case real_type: return (u256)(uint64_t)_v.get_real();
-		default: cwarn << "Bad type for scalar: " << _v.type();
-		}
-		return 0;
-	}
-
-	static void push(mObject& o, string const& _n, u256 _v)
-	{
-		if (_v < (u256)1 << 64)
-			o[_n] = (uint64_t)_v;
-		else
-			o[_n] = toString(_v);
-	}
-
-	static void push(mArray& a, u256 _v)
-	{
-		if (_v < (u256)1 << 64)
-			a.push_back((uint64_t)_v);
-		else
-			a.push_back(toString(_v));
-	}
-
-	mObject exportState()
-	{
-		mObject ret;
-		for (auto const& a: addresses)
-		{
-			mObject o;
-			push(o, "balance", get<0>(a.second));
-			push(o, "nonce", get<1>(a.second));
-			push(o, "extroPrice", get<2>(a.second));
-
-			mObject store;
-			string curKey;
-			u256 li = 0;
-			mArray curVal;
-			for (auto const& s: get<3>(a.second))
-			{
-				if (!li || s.first > li + 8)
-				{
-					if (li)
-						store[curKey] = curVal;
-					li = s.first;
-					curKey = toString(li);
-					curVal = mArray();
-				}
-				else
-					for (; li != s.first; ++li)
-						curVal.push_back(0);
-				push(curVal, s.second);
-				++li;
-			}
-			if (li)
-			{
-				store[curKey] = curVal;
-				o["store"] = store;
-			}
-			ret[toString(a.first)] = o;
-		}
-		return ret;
-	}
-
-	void importState(mObject& _o)
-	{
-		for (auto const& i: _o)
-		{
-			mObject o = i.second.get_obj();
-			auto& a = addresses[Address(i.first)];
-			get<0>(a) = toInt(o["balance"]);
-			get<1>(a) = toInt(o["nonce"]);
-			get<2>(a) = toInt(o["extroPrice"]);
-			if (o.count("store"))
-				for (auto const& j: o["store"].get_obj())
-				{
-					u256 adr(j.first);
-					for (auto const& k: j.second.get_array())
-#ifdef __clang__
-					{
-						map<u256, u256> & third = get<3>(a);
-						auto sFinder = third.find(adr);
-						if (sFinder != third.end())
-							sFinder->second = toInt(k);
-						else
-							third.insert(std::make_pair(adr, toInt(k)));
-						adr++;
-					}
-#else
-						get<3>(a)[adr++] = toInt(k);
-#endif
-				}
-			if (o.count("code"))
-			{
-				u256s d = compileLisp(o["code"].get_str());
-				for (unsigned i = 0; i < d.size(); ++i)
-#ifdef __clang__
-				{
-					map<u256, u256> & third = get<3>(a);
-					auto sFinder = third.find(i);
-					if (sFinder != third.end())
-						sFinder->second = d[i];
-					else
-						third.insert(std::make_pair(i, d[i]));
-				}
-#else
-					get<3>(a)[(u256)i] = d[i];
-#endif
-			}
-		}
-	}
-
-	mObject exportExec()
-	{
-		mObject ret;
-		ret["address"] = toString(myAddress);
-		ret["sender"] = toString(txSender);
-		push(ret, "value", txValue);
-		mArray d;
-		for (auto const& i: txData)
-			push(d, i);
-		ret["data"] = d;
-		return ret;
-	}
-
-	void importExec(mObject& _o)
-	{
-		myAddress = Address(_o["address"].get_str());
-		txSender = Address(_o["sender"].get_str());
-		txValue = toInt(_o["value"]);
-		for (auto const& j: _o["data"].get_array())
-			txData.push_back(toInt(j));
-	}
-
-	mArray exportTxs()
-	{
-		mArray ret;
-		for (Transaction const& tx: txs)
-		{
-			mObject o;
-			o["destination"] = toString(tx.receiveAddress);
-			push(o, "value", tx.value);
-			mArray d;
-			for (auto const& i: tx.data)
-				push(d, i);
-			o["data"] = d;
-			ret.push_back(o);
-		}
-		return ret;
-	}
-
-	void importTxs(mArray& _txs)
-	{
-		for (mValue& v: _txs)
-		{
-			auto tx = v.get_obj();
-			Transaction t;
-			t.receiveAddress = Address(tx["destination"].get_str());
-			t.value = toInt(tx["value"]);
-			for (auto const& j: tx["data"].get_array())
-				t.data.push_back(toInt(j));
-			txs.push_back(t);
-		}
-	}
-
-	void reset(u256 _myBalance, u256 _myNonce, u256s _myData)
-	{
-		txs.clear();
-		addresses.clear();
-		set(myAddress, _myBalance, _myNonce, _myData);
-	}
-
-	map<Address, tuple<u256, u256, u256, map<u256, u256>>> addresses;
-	Transactions txs;
-};
-
 #define CREATE_TESTS 0
 
 template <> class UnitTest<1>
@@ -408,6 +99,39 @@ public:
 					cwarn << fev.txs;
 					passed = false;
 				}
+
+				// Running from compiled code must be indistinguishable from interpreting.
+				VM cvm;
+				FakeExtVM cfev;
+				cfev.importEnv(o["env"].get_obj());
+				cfev.importState(o["pre"].get_obj());
+				for (auto i: o["exec"].get_array())
+				{
+					cfev.importExec(i.get_obj());
+					cvm.setCode(CompiledCode::compile(get<3>(cfev.addresses[cfev.myAddress])));
+					cvm.go(cfev);
+				}
+				if (cfev.addresses != fev.addresses || cfev.txs != fev.txs)
+				{
+					cwarn << "Test failed: compiled code behaves differently to interpreter.";
+					passed = false;
+				}
+
+				// Yielding after every step and resuming must be indistinguishable from running straight through.
+				VM rvm;
+				FakeExtVM rfev;
+				rfev.importEnv(o["env"].get_obj());
+				rfev.importState(o["pre"].get_obj());
+				for (auto i: o["exec"].get_array())
+				{
+					rfev.importExec(i.get_obj());
+					while (!rvm.go(rfev, 1)) {}
+				}
+				if (rfev.addresses != fev.addresses || rfev.txs != fev.txs)
+				{
+					cwarn << "Test failed: resumed execution behaves differently to uninterrupted.";
+					passed = false;
+				}
 			}
 		}
 		return passed;
@@ -443,11 +167,84 @@ public:
 	}
 };
 
+template <> class UnitTest<2>
+{
+public:
+	int operator()()
+	{
+		bool passed = true;
+		auto check = [&](bool _ok, char const* _what) { if (!_ok) { cwarn << "Test failed:" << _what; passed = false; } };
+
+		// A constant jump over some code that's thereby unreachable.
+		auto a = analyse("PUSH 6 JMP PUSH 1 STOP PUSH 2 STOP");
+		check(a.blocks().size() == 2 && a.blocks().at(0).successors == vector<unsigned>{6}, "constant jump");
+		check(a.reachableSize() == 6 && !a.isReachable(3) && a.isReachable(7), "unreachable code");
+		check(a.isJumpDest(6) && !a.isJumpDest(1) && !a.isPathological(), "jump destinations");
+
+		// A loop back into the middle of the first block.
+		a = analyse("PUSH 0 loop: PUSH 1 ADD DUP PUSH 10 LT PUSH loop SWAP JMPI STOP");
+		check(a.blocks().size() == 3 && a.blocks().at(0).end == 2 && a.blocks().at(2).successors.size() == 2, "loop");
+		check(!a.hasDynamicJumps() && a.reachableSize() == 14, "loop reachability");
+
+		check(analyse("TXDATAN JMP STOP STOP").hasDynamicJumps() && analyse("TXDATAN JMP STOP STOP").isReachable(3), "computed jump");
+		check(analyse("PUSH 1 JMP").jumpsIntoData(), "jump into PUSH operand");
+		check(analyse("PUSH 4 JMP STOP 256").reachesBadInstruction(), "bad instruction");
+		check(!analyse("STOP 256").isPathological(), "unreachable bad instruction");
+
+		return passed ? 0 : 1;
+	}
+
+	CodeAnalysis analyse(string const& _asm)
+	{
+		map<u256, u256> mem;
+		u256s code = assemble(_asm, true);
+		for (unsigned i = 0; i < code.size(); ++i)
+			mem[i] = code[i];
+		return CodeAnalysis(CompiledCode(mem));
+	}
+};
+
+template <> class UnitTest<3>
+{
+public:
+	int operator()()
+	{
+		bool passed = true;
+		auto check = [&](bool _ok, char const* _what) { if (!_ok) { cwarn << "Test failed:" << _what; passed = false; } };
+
+		// Hash 40 bytes: the whole of the top word and the first 8 of the one below. The 7 underneath must be left.
+		bytes in(64);
+		bytesRef top(in.data(), 32);
+		bytesRef next(in.data() + 32, 32);
+		toBigEndian(u256(0x61), top);
+		toBigEndian(u256(0x62) << 248, next);
+		std::array<byte, 32> sha;
+		CryptoPP::SHA256().CalculateDigest(sha.data(), in.data(), 40);
+		std::array<byte, 20> ripemd;
+		CryptoPP::RIPEMD160().CalculateDigest(ripemd.data(), in.data(), 40);
+
+		FeeStructure fees;
+		fees.setMultiplier(1);
+		for (auto h: { make_pair(string("SHA256"), fromBigEndian<u256>(sha)), make_pair(string("RIPEMD160"), (u256)fromBigEndian<u160>(ripemd)) })
+		{
+			VM vm;
+			FakeExtVM fev(fees, BlockInfo(), BlockInfo(), 0);
+			fev.setContract(toAddress(sha3("contract")), ether, 0, assemble("PUSH 7 PUSH " + toString((u256)0x62 << 248) + " PUSH 97 PUSH 40 " + h.first + " PUSH 100 SSTORE PUSH 101 SSTORE STOP", true));
+			vm.go(fev);
+			check(fev.store(100) == h.second, "hash of stack words");
+			check(fev.store(101) == 7, "hash leaves the rest of the stack");
+			check(vm.runFee() == fees.m_cryptoFee + 2 * fees.m_dataFee, "hash fee");
+		}
+
+		return passed ? 0 : 1;
+	}
+};
+
 }
 
 int vmTest()
 {
 	cnote << "Testing VM...";
-	return UnitTest<1>()();
+	return UnitTest<1>()() + UnitTest<2>()() + UnitTest<3>()();
 }
 